@@ -0,0 +1,171 @@
+#include <string>
+#include <vector>
+#include <charconv>
+#include <fstream>
+#include <optional>
+#include <sstream>
+#include <string_view>
+#include <iostream>
+
+#include "vulkan/application.h"
+#include "util/assets.h"
+#include "app/camera.h"
+#include "app/headless.h"
+#include "app/reference.h"
+
+// Renders every camera path at every size in both modes through the headless renderer and appends one JSON
+// object per run to the output file, with the full frame time distribution. Runs on software ICDs such as
+// lavapipe, and on the CPU port with --cpu or when there is no usable Vulkan implementation at all
+namespace {
+    struct BenchOptions {
+        std::vector<std::string> Paths {"still", "flyover", "orbit"};
+        std::vector<std::pair<uint32_t, uint32_t>> Sizes {{320, 180}, {640, 360}, {1280, 720}};
+        std::vector<bool> Modes {true, false}; // PathTracing
+        uint32_t Images = 3;
+        bool Cpu = false;
+        std::string Output = "vxrt_bench.jsonl";
+    };
+
+    std::vector<std::string> Split(const std::string& list) {
+        std::vector<std::string> items;
+        std::istringstream in(list);
+        for (std::string item; std::getline(in, item, ',');) if (!item.empty()) items.push_back(item);
+        return items;
+    }
+
+    // Empty unless all of `text` is a decimal number above 0
+    std::optional<uint32_t> ParseCount(std::string_view text) {
+        uint32_t value = 0;
+        const auto end = text.data() + text.size();
+        const auto [ptr, error] = std::from_chars(text.data(), end, value);
+        if (error != std::errc() || ptr != end || value == 0) return std::nullopt;
+        return value;
+    }
+
+    // Empty, after saying why, when an argument is invalid
+    std::optional<BenchOptions> ParseOptions(int argc, char** argv) {
+        BenchOptions options;
+        for (int i = 1; i < argc; ++i) {
+            const std::string arg = argv[i];
+            if (arg == "--cpu") {
+                options.Cpu = true;
+            }
+            else if (arg == "--paths" && i + 1 < argc) {
+                options.Paths = Split(argv[++i]);
+            }
+            else if (arg == "--sizes" && i + 1 < argc) {
+                options.Sizes.clear();
+                for (auto& size : Split(argv[++i])) {
+                    const std::string_view text = size;
+                    const auto split = text.find('x');
+                    const auto width = ParseCount(text.substr(0, split));
+                    const auto height = split == text.npos ? std::nullopt : ParseCount(text.substr(split + 1));
+                    if (!width || !height) {
+                        std::cout << "Invalid size " << size << ", expected WIDTHxHEIGHT above 0" << std::endl;
+                        return std::nullopt;
+                    }
+                    options.Sizes.emplace_back(*width, *height);
+                }
+            }
+            else if (arg == "--modes" && i + 1 < argc) {
+                options.Modes.clear();
+                for (auto& mode : Split(argv[++i])) {
+                    if (mode != "path_tracing" && mode != "profiler") {
+                        std::cout << "Unknown mode " << mode << ", expected path_tracing or profiler" << std::endl;
+                        return std::nullopt;
+                    }
+                    options.Modes.push_back(mode == "path_tracing");
+                }
+            }
+            else if (arg == "--images" && i + 1 < argc) {
+                const auto images = ParseCount(argv[++i]);
+                if (!images) {
+                    std::cout << "Invalid image count " << argv[i] << ", expected a number above 0" << std::endl;
+                    return std::nullopt;
+                }
+                options.Images = *images;
+            }
+            else if (arg == "--out" && i + 1 < argc) {
+                options.Output = argv[++i];
+            }
+            else {
+                std::cout << "Unknown argument " << arg << ", or its value is missing" << std::endl;
+                return std::nullopt;
+            }
+        }
+        return options;
+    }
+
+    void WriteRun(std::ostream& out, const std::string& renderer, const std::string& path,
+            const HeadlessOptions& run, const FrameTimings& timings) {
+        out << "{\"renderer\":\"" << renderer << "\",\"path\":\"" << path << "\",\"width\":" << run.Width
+            << ",\"height\":" << run.Height << ",\"mode\":\"" << (run.PathTracing ? "path_tracing" : "profiler")
+            << "\",\"frames\":" << timings.Milliseconds.size() << ",\"min_ms\":" << timings.Min()
+            << ",\"avg_ms\":" << timings.Average() << ",\"p50_ms\":" << timings.Percentile(0.5)
+            << ",\"p90_ms\":" << timings.Percentile(0.9) << ",\"p99_ms\":" << timings.Percentile(0.99)
+            << ",\"max_ms\":" << timings.Max() << ",\"frame_ms\":[";
+        for (size_t i = 0; i < timings.Milliseconds.size(); ++i) {
+            out << (i ? "," : "") << timings.Milliseconds[i];
+        }
+        out << "]}" << std::endl;
+    }
+}
+
+int main(int argc, char** argv) {
+    const auto parsed = ParseOptions(argc, argv);
+    if (!parsed) return 1;
+    const auto& options = *parsed;
+    bool cpu = options.Cpu;
+    if (!cpu) {
+        try {
+            Vulkan::Application::CreateHeadlessInstance({{}, "vxrt_bench", "vxrt", 1, 1});
+        }
+        catch (std::exception& err) {
+            std::cout << "No usable Vulkan instance (" << err.what() << "), using the CPU renderer" << std::endl;
+            cpu = true;
+        }
+    }
+
+    std::ofstream out(options.Output, std::ios::out | std::ios::app);
+    if (!out) {
+        std::cout << "Can not open " << options.Output << std::endl;
+        return 1;
+    }
+    int failures = 0;
+    for (auto& name : options.Paths) {
+        std::vector<CameraPose> poses;
+        try {
+            std::istringstream stream(std::string(Utils::Assets::Load("paths/" + name + ".path").View()));
+            poses = CameraPath::Parse(stream).Bake();
+        }
+        catch (std::exception& err) {
+            std::cout << "Camera path " << name << ": " << err.what() << std::endl;
+            ++failures;
+            continue;
+        }
+        for (auto [width, height] : options.Sizes) {
+            for (bool pathTracing : options.Modes) {
+                HeadlessOptions run;
+                run.Width = width;
+                run.Height = height;
+                run.Frames = static_cast<uint32_t>(poses.size());
+                run.Images = options.Images;
+                run.PathTracing = pathTracing;
+                run.Poses = poses;
+                FrameTimings timings;
+                ReferenceStatistics stats;
+                const bool done = cpu ? Reference_Renderer().RunSecure(run, timings, stats)
+                                      : Headless_Renderer().RunSecure(run, timings);
+                std::cout << name << " " << width << "x" << height << (pathTracing ? " path tracing: " : " profiler: ");
+                if (!done) {
+                    std::cout << "failed" << std::endl;
+                    ++failures;
+                    continue;
+                }
+                timings.Report(std::cout);
+                WriteRun(out, cpu ? "cpu" : "vulkan", name, run, timings);
+            }
+        }
+    }
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,24 @@
+#include <iostream>
+#include "util/pack.h"
+
+// vxrt_pack <assets directory> <output pack>, run by the build, see README
+int main(int argc, char** argv) {
+    if (argc != 3) {
+        std::cout << "usage: vxrt_pack <assets directory> <output pack>" << std::endl;
+        return 1;
+    }
+    try {
+        Utils::AssetPack::Write(argv[1], argv[2]);
+    }
+    catch (std::exception& err) {
+        std::cout << "vxrt_pack: " << err.what() << std::endl;
+        return 1;
+    }
+    const auto pack = Utils::AssetPack::Open(argv[2]);
+    if (!pack) {
+        std::cout << "vxrt_pack: " << argv[2] << " does not read back" << std::endl;
+        return 1;
+    }
+    std::cout << "Packed " << pack->GetCount() << " assets into " << argv[2] << std::endl;
+    return 0;
+}
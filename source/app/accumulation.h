@@ -0,0 +1,47 @@
+#pragma once
+
+#include "uniforms.h"
+#include "../util/hash.h"
+
+namespace {
+    // Ping-pong history for progressive path tracing. Frame N renders into target N % 2 while Final.fsh reads
+    // the other one as PrevFrame, so the running average never leaves the device and is never copied
+    class Accumulation {
+    public:
+        // Fills in the per-sample fields. Anything else that differs from the previous frame (camera,
+        // projection, resolution, mode...) restarts the average from the first sample
+        void Advance(FrameUniforms& uniforms) noexcept {
+            if (const auto key = HashScene(uniforms); key != _key) {
+                _key = key;
+                _samples = 0;
+            }
+            uniforms.SampleCount = _samples++;
+            uniforms.RandomSeed = static_cast<float>(_frame % (1u << 24u));
+            _write = static_cast<uint32_t>(_frame++ % 2);
+        }
+
+        void Reset() noexcept { _samples = 0; }
+
+        uint32_t GetWriteIndex() const noexcept { return _write; }
+
+        int32_t GetSampleCount() const noexcept { return _samples; }
+    private:
+        static uint64_t HashScene(const FrameUniforms& uniforms) noexcept {
+            return Utils::Hasher()
+                    .Add(uniforms.ProjectionMatrix.data(), sizeof(Mat4))
+                    .Add(uniforms.ModelViewMatrix.data(), sizeof(Mat4))
+                    .Add(uniforms.CameraPosition.data(), sizeof(uniforms.CameraPosition))
+                    .Add(uniforms.NoiseTextureSize)
+                    .Add(uniforms.NoiseOffset.data(), sizeof(uniforms.NoiseOffset))
+                    .Add(uniforms.PathTracing)
+                    .Add(uniforms.FrameWidth)
+                    .Add(uniforms.FrameHeight)
+                    .Get();
+        }
+
+        uint64_t _key{};
+        uint64_t _frame{};
+        int32_t _samples{};
+        uint32_t _write{};
+    };
+}
@@ -0,0 +1,75 @@
+#include "camera.h"
+
+#include <cmath>
+#include <string>
+#include <sstream>
+
+namespace {
+    constexpr float DegreesToRadians = 3.14159265f / 180.0f;
+
+    float Lerp(float a, float b, float t) noexcept { return a + (b - a) * t; }
+}
+
+std::array<float, 16> CameraPose::GetRotation() const noexcept {
+    const auto sy = std::sin(Yaw * DegreesToRadians), cy = std::cos(Yaw * DegreesToRadians);
+    const auto sp = std::sin(Pitch * DegreesToRadians), cp = std::cos(Pitch * DegreesToRadians);
+    // Yaw after pitch, the columns are the camera's right, up and forward axes
+    return {
+            cy, 0.0f, -sy, 0.0f,
+            -sy * sp, cp, -cy * sp, 0.0f,
+            sy * cp, sp, cy * cp, 0.0f,
+            0.0f, 0.0f, 0.0f, 1.0f
+    };
+}
+
+std::array<float, 16> CameraPose::GetView() const noexcept {
+    const auto rotation = GetRotation();
+    std::array<float, 16> view {};
+    for (int c = 0; c < 4; ++c) {
+        for (int r = 0; r < 4; ++r) view[c * 4 + r] = rotation[r * 4 + c];
+    }
+    return view;
+}
+
+CameraPath CameraPath::Parse(std::istream& in) {
+    CameraPath path;
+    std::string line;
+    while (std::getline(in, line)) {
+        line = line.substr(0, line.find('#'));
+        if (line.find_first_not_of(" \t\r") == std::string::npos) continue;
+        std::istringstream fields(line);
+        Key key {};
+        auto& pose = key.Pose;
+        if (!(fields >> key.Frame >> pose.Position[0] >> pose.Position[1] >> pose.Position[2] >> pose.Yaw >> pose.Pitch)) {
+            throw ParseError();
+        }
+        if (!path._keys.empty() && key.Frame <= path._keys.back().Frame) throw ParseError();
+        path._keys.push_back(key);
+    }
+    if (path._keys.empty()) throw ParseError();
+    return path;
+}
+
+CameraPose CameraPath::Sample(uint32_t frame) const noexcept {
+    if (_keys.empty()) return {};
+    if (frame <= _keys.front().Frame) return _keys.front().Pose;
+    for (size_t i = 1; i < _keys.size(); ++i) {
+        const auto& a = _keys[i - 1];
+        const auto& b = _keys[i];
+        if (frame > b.Frame) continue;
+        const auto t = float(frame - a.Frame) / float(b.Frame - a.Frame);
+        CameraPose pose;
+        for (int c = 0; c < 3; ++c) pose.Position[c] = Lerp(a.Pose.Position[c], b.Pose.Position[c], t);
+        pose.Yaw = Lerp(a.Pose.Yaw, b.Pose.Yaw, t);
+        pose.Pitch = Lerp(a.Pose.Pitch, b.Pose.Pitch, t);
+        return pose;
+    }
+    return _keys.back().Pose;
+}
+
+std::vector<CameraPose> CameraPath::Bake() const {
+    std::vector<CameraPose> poses;
+    poses.reserve(GetFrameCount());
+    for (uint32_t frame = 0; frame < GetFrameCount(); ++frame) poses.push_back(Sample(frame));
+    return poses;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <array>
+#include <vector>
+#include <cstdint>
+#include <istream>
+#include "../util/exceptions.h"
+
+// Where the camera is and where it looks. Position is in FrameUniforms.CameraPosition units, yaw turns from +z
+// towards +x around +y and pitch looks up, both in degrees
+struct CameraPose {
+    std::array<float, 3> Position {0.0f, 20.0f, 0.0f};
+    float Yaw = 0.0f;
+    float Pitch = 0.0f;
+
+    // Camera to world rotation, column major like FrameUniforms.ModelViewInverse
+    std::array<float, 16> GetRotation() const noexcept;
+
+    // World to camera, its transpose
+    std::array<float, 16> GetView() const noexcept;
+};
+
+// Keyframed camera motion, linearly interpolated between keys. The text form has one "frame x y z yaw pitch"
+// line per key with frames strictly increasing, blank lines and anything after '#' are ignored
+class CameraPath {
+public:
+    VXRT_EXCEPTION(ParseError, "Malformed Camera Path")
+
+    static CameraPath Parse(std::istream& in);
+
+    // Up to and including the last key
+    uint32_t GetFrameCount() const noexcept { return _keys.empty() ? 0 : _keys.back().Frame + 1; }
+
+    CameraPose Sample(uint32_t frame) const noexcept;
+
+    // One pose per frame
+    std::vector<CameraPose> Bake() const;
+private:
+    struct Key {
+        uint32_t Frame;
+        CameraPose Pose;
+    };
+
+    std::vector<Key> _keys;
+};
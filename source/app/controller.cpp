@@ -0,0 +1,79 @@
+#include "controller.h"
+
+#include <algorithm>
+
+CameraPose CameraState::At(Clock::time_point time) const noexcept {
+    auto pose = Pose;
+    const auto seconds = std::chrono::duration<float>(time - Timestamp).count();
+    if (seconds <= 0.0f) return pose;
+    for (int i = 0; i < 3; ++i) pose.Position[i] += Velocity[i] * seconds;
+    return pose;
+}
+
+void CameraController::Handle(const SDL_Event& event) noexcept {
+    const auto now = CameraState::Clock::now();
+    auto keys = _keys;
+    auto pose = _state.Pose;
+    switch (event.type) {
+        case SDL_KEYDOWN:
+            keys |= GetKey(event.key.keysym.scancode);
+            break;
+        case SDL_KEYUP:
+            keys &= ~GetKey(event.key.keysym.scancode);
+            break;
+        case SDL_MOUSEMOTION:
+            if (!(event.motion.state & SDL_BUTTON_LMASK)) return;
+            pose.Yaw += static_cast<float>(event.motion.xrel) * Sensitivity;
+            pose.Pitch = std::clamp(pose.Pitch - static_cast<float>(event.motion.yrel) * Sensitivity, -89.0f, 89.0f);
+            break;
+        case SDL_WINDOWEVENT:
+            if (event.window.event != SDL_WINDOWEVENT_FOCUS_LOST) return;
+            keys = 0;
+            break;
+        default:
+            return;
+    }
+    if (keys == _keys && pose.Yaw == _state.Pose.Yaw && pose.Pitch == _state.Pose.Pitch) return;
+    // Moves the camera up to now at the old velocity, the new one starts here
+    const auto position = _state.At(now).Position;
+    _keys = keys;
+    _state.Pose = pose;
+    _state.Pose.Position = position;
+    _state.Velocity = GetVelocity();
+    _state.Timestamp = now;
+    ++_state.Sequence;
+    Publish();
+}
+
+uint32_t CameraController::GetKey(SDL_Scancode code) noexcept {
+    switch (code) {
+        case SDL_SCANCODE_W: return Forward;
+        case SDL_SCANCODE_S: return Back;
+        case SDL_SCANCODE_A: return Left;
+        case SDL_SCANCODE_D: return Right;
+        case SDL_SCANCODE_E: return Up;
+        case SDL_SCANCODE_Q: return Down;
+        case SDL_SCANCODE_LSHIFT:
+        case SDL_SCANCODE_RSHIFT: return Fast;
+        default: return 0;
+    }
+}
+
+std::array<float, 3> CameraController::GetVelocity() const noexcept {
+    // Columns 0 and 2 of the rotation are the camera's right and forward axes, up is always the world's
+    const auto rotation = _state.Pose.GetRotation();
+    const auto axis = [this](Key positive, Key negative) {
+        return static_cast<float>(!!(_keys & positive)) - static_cast<float>(!!(_keys & negative));
+    };
+    const auto forward = axis(Forward, Back), right = axis(Right, Left), up = axis(Up, Down);
+    const auto speed = _keys & Fast ? Speed * FastFactor : Speed;
+    std::array<float, 3> velocity {};
+    for (int i = 0; i < 3; ++i) velocity[i] = (right * rotation[i] + forward * rotation[8 + i]) * speed;
+    velocity[1] += up * speed;
+    return velocity;
+}
+
+void CameraController::Publish() noexcept {
+    _published.GetBack() = _state;
+    _published.Publish();
+}
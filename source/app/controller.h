@@ -0,0 +1,52 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <SDL2/SDL.h>
+#include "camera.h"
+#include "../util/triple_buffer.h"
+
+// The camera as of the input event that last changed it, moving at Velocity from then on
+struct CameraState {
+    using Clock = std::chrono::steady_clock;
+
+    CameraPose Pose;
+    std::array<float, 3> Velocity {}; // World units per second
+    Clock::time_point Timestamp; // When the event behind Pose was handled
+    uint64_t Sequence = 0; // Counts the events that changed the camera, 0 until the first one
+
+    // Where the camera is at `time`
+    CameraPose At(Clock::time_point time) const noexcept;
+};
+
+// Fly camera driven by the SDL thread: WASD moves, E and Q rise and sink, shift is faster, dragging with the left
+// button looks around. Every event that changes it publishes a new CameraState, the render thread picks up the
+// newest one without ever waiting for the SDL thread
+class CameraController {
+public:
+    static constexpr float Speed = 8.0f; // World units per second
+    static constexpr float FastFactor = 4.0f;
+    static constexpr float Sensitivity = 0.2f; // Degrees per pixel
+
+    // SDL thread only. Keyboard, mouse and SDL_WINDOWEVENT_FOCUS_LOST, which releases every key
+    void Handle(const SDL_Event& event) noexcept;
+
+    // Render thread only
+    const CameraState& Read() noexcept { return _published.Read(); }
+private:
+    enum Key : uint32_t {
+        Forward = 1u << 0u, Back = 1u << 1u, Left = 1u << 2u, Right = 1u << 3u, Up = 1u << 4u, Down = 1u << 5u,
+        Fast = 1u << 6u
+    };
+
+    static uint32_t GetKey(SDL_Scancode code) noexcept;
+
+    std::array<float, 3> GetVelocity() const noexcept;
+
+    void Publish() noexcept;
+
+    CameraState _state;
+    uint32_t _keys = 0;
+    Utils::TripleBuffer<CameraState> _published;
+};
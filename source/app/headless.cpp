@@ -0,0 +1,87 @@
+#include "headless.h"
+#include "passes.h"
+#include "accumulation.h"
+#include "../vulkan/frame.h"
+
+#include <chrono>
+
+bool Headless_Renderer::RunSecure(const HeadlessOptions& options, FrameTimings& timings) noexcept {
+    try {
+        timings = Run(options);
+        return true;
+    }
+    catch (vk::SystemError& err) {
+        std::cout << "vk::SystemError: " << err.what() << std::endl;
+    }
+    catch (std::exception& err) {
+        std::cout << typeid(err).name() << ": " << err.what() << std::endl;
+    }
+    catch (...) {
+        std::cout << "unknown error" << std::endl;
+    }
+    std::cout << "Abnormal Headless Render Exit" << std::endl;
+    return false;
+}
+
+FrameTimings Headless_Renderer::Run(const HeadlessOptions& options) {
+    auto result = std::make_shared<ResultPack>();
+    const auto images = std::max(options.Images, 1u);
+    Vulkan::Builder()
+            .Push(ResultKey, result)
+            .Use<ShaderCompileStart>()
+            .Use<PhysicalDeviceSelector>(std::vector<const char*>())
+            .Use<HeadlessQueueSelector>()
+            .Use<DeviceCreator>(std::vector<const char*>())
+            .Use<OffscreenTargetBuilder>(vk::Extent2D(options.Width, options.Height), images)
+            .Use<RenderPassBuilder>(vk::ImageLayout::eTransferSrcOptimal)
+            .Use<FramebufferBuilder>()
+            .Use<AccumulationTargetBuilder>()
+            .Use<ShaderCompile>()
+            .Use<PipelineCacheLoader>()
+            .Use<PipelineBuilder>()
+            .Use<PresentPipelineBuilder>()
+            .Use<SceneResourceBuilder>(images)
+            .Use<DescriptorSetBuilder>()
+            .Use<AccumulationBinder>()
+            .Build().Print(std::cout);
+
+    Vulkan::FrameRing frames(result->Device.get(), result->GraphicsFamily, images);
+    auto profiler = CreateProfiler(*result, images, options.GpuProfile);
+    if (!options.GpuProfileCsv.empty()) profiler.OpenCsv(options.GpuProfileCsv);
+    using Clock = std::chrono::steady_clock;
+    FrameTimings timings;
+    auto last = Clock::now();
+    auto complete = [&]() {
+        const auto now = Clock::now();
+        const auto ms = std::chrono::duration<double, std::milli>(now - last).count();
+        timings.Milliseconds.push_back(ms);
+        timings.TotalMilliseconds += ms;
+        last = now;
+    };
+
+    // One slot per offscreen image, so up to `images` frames are queued at once. Unless the options give a
+    // camera path every frame adds one more sample to the same still
+    Accumulation accumulation;
+    FrameUniforms uniforms;
+    uniforms.FrameWidth = static_cast<int32_t>(options.Width);
+    uniforms.FrameHeight = static_cast<int32_t>(options.Height);
+    uniforms.PathTracing = options.PathTracing ? 1 : 0;
+    for (uint32_t frame = 0; frame < options.Frames; ++frame) {
+        auto& slot = frames.Acquire();
+        if (frame >= images) complete(); // Acquire just retired frame - images
+        profiler.BeginFrame(slot.Commands, slot.Index, frame);
+        if (!options.Poses.empty()) uniforms.SetCamera(options.Poses[frame % options.Poses.size()]);
+        accumulation.Advance(uniforms);
+        const auto uploads = RecordFrame(slot.Commands, *result, slot.Index, accumulation.GetWriteIndex(),
+                uniforms, profiler, slot.Index);
+        frames.Submit(result->GraphicsQueue, slot, {uploads});
+    }
+    for (uint32_t frame = std::max(options.Frames, images) - images; frame < options.Frames; ++frame) {
+        frames.WaitFrame(frame);
+        complete();
+    }
+    result->Device->waitIdle();
+    profiler.Flush();
+    profiler.Report(std::cout);
+    return timings;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <ostream>
+#include <algorithm>
+#include "camera.h"
+#include "../util/rolling.h"
+
+struct HeadlessOptions {
+    uint32_t Width = 800, Height = 800;
+    uint32_t Frames = 300;
+    uint32_t Images = 3;
+    bool PathTracing = true;
+    bool GpuProfile = false; // Per pass GPU timings, reported with the frame timings
+    std::string GpuProfileCsv;
+    std::vector<CameraPose> Poses; // Frame i looks from Poses[i % size], empty keeps the default view
+};
+
+// Host side completion interval of every frame, which is the steady state throughput of the renderer
+struct FrameTimings {
+    std::vector<double> Milliseconds;
+    double TotalMilliseconds{};
+
+    double Min() const noexcept {
+        return Milliseconds.empty() ? 0.0 : *std::min_element(Milliseconds.begin(), Milliseconds.end());
+    }
+
+    double Max() const noexcept {
+        return Milliseconds.empty() ? 0.0 : *std::max_element(Milliseconds.begin(), Milliseconds.end());
+    }
+
+    double Average() const noexcept {
+        return Milliseconds.empty() ? 0.0 : TotalMilliseconds / Milliseconds.size();
+    }
+
+    // Nearest rank, `fraction` in [0, 1]
+    double Percentile(double fraction) const { return Utils::Percentile(Milliseconds, fraction); }
+
+    double FramesPerSecond() const noexcept {
+        return TotalMilliseconds > 0.0 ? Milliseconds.size() * 1000.0 / TotalMilliseconds : 0.0;
+    }
+
+    void Report(std::ostream& out) const {
+        out << "frames: " << Milliseconds.size() << ", total: " << TotalMilliseconds << "ms, min: " << Min()
+            << "ms, avg: " << Average() << "ms, max: " << Max() << "ms, fps: " << FramesPerSecond() << std::endl;
+    }
+};
+
+class Headless_Renderer {
+public:
+    bool RunSecure(const HeadlessOptions& options, FrameTimings& timings) noexcept;
+private:
+    FrameTimings Run(const HeadlessOptions& options);
+};
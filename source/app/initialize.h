@@ -1,78 +1,159 @@
 #pragma once
 
+#include <array>
+#include <chrono>
+#include <cstring>
+#include <utility>
+#include <iterator>
+#include <algorithm>
 #include <iostream>
 #include "../vulkan/builder.h"
 #include "../vulkan/application.h"
 #include "../vulkan/queue.h"
 #include "../vulkan/shader.h"
+#include "../vulkan/command.h"
+#include "../vulkan/resource.h"
+#include "../vulkan/uploader.h"
+#include "../vulkan/descriptor.h"
+#include "../vulkan/device_select.h"
+#include "../vulkan/pipeline_cache.h"
 #include "../util/assets.h"
+#include "../scene/noise.h"
+#include "../scene/octree.h"
+#include "uniforms.h"
 
 namespace {
     struct ResultPack {
         std::shared_ptr<SDL::Window> Window;
         std::unique_ptr<Vulkan::VulkanFacet> WindowVk;
+        vk::PhysicalDevice PhysicalDevice;
+        vk::PhysicalDeviceFeatures Features; // Enabled on Device
+        bool TimelineSemaphores = false; // Enabled on Device, Vulkan 1.2 devices that have them
         vk::UniqueDevice Device;
+        std::unique_ptr<Vulkan::Allocator> Allocator; // Backs every image and buffer below
+        uint32_t GraphicsFamily{}, PresentFamily{}, ComputeFamily{}, TransferFamily{};
+        // Compute and transfer are the graphics queue on devices without families of their own for them
+        vk::Queue GraphicsQueue, PresentQueue, ComputeQueue, TransferQueue;
         vk::Format SurfaceFormat;
+        vk::Extent2D Extent;
+        vk::PresentModeKHR PresentMode = vk::PresentModeKHR::eFifo;
         vk::UniqueSwapchainKHR SwapChain;
         std::vector<vk::UniqueImageView> ImageViews;
+        std::vector<Vulkan::Image> Offscreen;
         vk::UniqueRenderPass RenderPass;
+        std::vector<vk::UniqueFramebuffer> Framebuffers;
+        vk::UniqueRenderPass AccumulationPass;
+        std::array<Vulkan::Image, 2> Accumulation;
+        std::array<vk::UniqueFramebuffer, 2> AccumulationFramebuffers;
         vk::UniqueShaderModule Vertex;
         vk::UniqueShaderModule Pixel;
+        vk::UniqueShaderModule PresentPixel;
+        Vulkan::ShaderLayout SceneShaders; // Final.vsh and Final.fsh
+        Vulkan::ShaderLayout PresentShaders; // Final.vsh and Present.fsh
+        vk::UniqueDescriptorSetLayout DescriptorSetLayout;
+        vk::UniquePipelineLayout PipelineLayout;
+        vk::UniqueDescriptorSetLayout PresentSetLayout;
+        vk::UniquePipelineLayout PresentLayout;
+        std::unique_ptr<Vulkan::PipelineCache> PipelineCache;
         vk::UniquePipeline Pipeline;
+        vk::UniquePipeline PresentPipeline;
+        std::unique_ptr<Vulkan::FrameArena> Uniforms; // A FrameUniforms slot per frame in flight
+        std::unique_ptr<Vulkan::Uploader> Uploads; // On TransferQueue, for GraphicsQueue's fragment shaders
+        Vulkan::Buffer TreeData;
+        Vulkan::Image NoiseTexture, MaxTexture, MinTexture;
+        vk::UniqueSampler Sampler;
+        std::unique_ptr<Vulkan::DescriptorAllocator> Descriptors;
+        // Set i renders into Accumulation[i] and reads the other target as PrevFrame,
+        // present set i resolves Accumulation[i]
+        std::array<vk::DescriptorSet, 2> DescriptorSets;
+        std::array<vk::DescriptorSet, 2> PresentSets;
 
         ~ResultPack() {
+            Descriptors.reset();
+            Sampler.reset();
+            MinTexture = {};
+            MaxTexture = {};
+            NoiseTexture = {};
+            TreeData = {};
+            Uniforms.reset();
+            Uploads.reset();
+            PresentPipeline.reset();
             Pipeline.reset();
+            PipelineCache.reset();
+            PresentLayout.reset();
+            PresentSetLayout.reset();
+            PipelineLayout.reset();
+            DescriptorSetLayout.reset();
+            PresentPixel.reset();
             Pixel.reset();
             Vertex.reset();
+            for (auto& x : AccumulationFramebuffers) x.reset();
+            for (auto& x : Accumulation) x = {};
+            AccumulationPass.reset();
+            Framebuffers.clear();
             RenderPass.reset();
+            Offscreen.clear();
             for (auto& x : ImageViews) x.reset();
             SwapChain.reset();
+            Allocator.reset();
             Device.reset();
             WindowVk.reset();
         }
     };
 
-    constexpr const char* PhysicalDeviceName = "select.physical_device";
-    constexpr const char* DeviceQueueName = "select.device_queue";
-    constexpr const char* ResultName = "select.result";
-    constexpr const char* QueueIndexName = "select.queue_index";
+    using SpirvFuture = std::shared_future<std::vector<unsigned int>>;
+
+    constexpr Vulkan::Key<std::shared_ptr<ResultPack>> ResultKey{"select.result"};
+    constexpr Vulkan::Key<vk::PhysicalDevice> PhysicalDeviceKey{"select.physical_device"};
+    constexpr Vulkan::Key<Vulkan::QueueFamilies> QueueFamilyKey{"select.queue_families"};
+    constexpr Vulkan::Key<SpirvFuture> VertexSpirvKey{"shader.vertex_spirv"};
+    constexpr Vulkan::Key<SpirvFuture> PixelSpirvKey{"shader.pixel_spirv"};
+    constexpr Vulkan::Key<SpirvFuture> PresentSpirvKey{"shader.present_spirv"};
+
+    // The parts of the ResultPack the steps fill in
+    constexpr Vulkan::Token WindowToken{"result.window"}; // Window, WindowVk
+    constexpr Vulkan::Token DeviceToken{"result.device"}; // Device and its queues, features and allocator
+    constexpr Vulkan::Token SubmitToken{"result.submit"}; // GraphicsQueue submissions, which must not overlap
+    constexpr Vulkan::Token TransferSubmitToken{"result.transfer_submit"}; // Same for TransferQueue
+    constexpr Vulkan::Token SurfaceToken{"result.surface"}; // Format, extent, swapchain or offscreen images
+    constexpr Vulkan::Token RenderPassToken{"result.render_pass"};
+    constexpr Vulkan::Token FramebufferToken{"result.framebuffers"};
+    constexpr Vulkan::Token AccumulationToken{"result.accumulation"}; // Targets, their pass and framebuffers
+    constexpr Vulkan::Token ShaderToken{"result.shaders"}; // Modules and their reflected layouts
+    constexpr Vulkan::Token PipelineCacheToken{"result.pipeline_cache"};
+    constexpr Vulkan::Token ScenePipelineToken{"result.scene_pipeline"}; // With its set and pipeline layouts
+    constexpr Vulkan::Token PresentPipelineToken{"result.present_pipeline"};
+    constexpr Vulkan::Token SceneResourceToken{"result.scene_resources"}; // Uploads, uniforms, tree, textures...
+    constexpr Vulkan::Token DescriptorSetToken{"result.descriptor_sets"};
 
     class InitializeBuildStep : public Vulkan::IBuilder {
     protected:
         static ResultPack& GetResults(Vulkan::Builder& builder) {
-            auto clone = builder.Fetch<std::shared_ptr<ResultPack>>(ResultName);
+            auto clone = builder.Fetch(ResultKey);
             return *Utils::RequireNonNull(clone);
         }
     };
 
-    class ConsoleDeviceSelector : public InitializeBuildStep {
+    // Scores the devices instead of asking, so unattended runs never block. See Vulkan::DeviceSelector for the
+    // $VXRT_DEVICE and config file overrides. Runs after EnableWindow when there is a window, whose surface the
+    // device has to present to
+    class PhysicalDeviceSelector : public InitializeBuildStep {
     public:
+        explicit PhysicalDeviceSelector(std::vector<const char*> extensions) noexcept
+                :_extensions(std::move(extensions)) { }
+
         void Build(Vulkan::Builder& builder) override {
-            builder.Push(PhysicalDeviceName, DeviceSelectDialog(Vulkan::Application::EnumeratePhysicalDevices()));
+            const auto& window = GetResults(builder).WindowVk;
+            const Vulkan::DeviceSelector selector(_extensions, window ? window->GetSurface() : vk::SurfaceKHR());
+            builder.Push(PhysicalDeviceKey, selector.Select(Vulkan::Application::EnumeratePhysicalDevices(),
+                    Vulkan::DeviceSelector::GetPreference(), std::cout));
         }
-    private:
-        static vk::PhysicalDevice DeviceSelectDialog(const std::vector<vk::PhysicalDevice>& devices) {
-            int counter = 0;
-            std::cout << "Devices:" << std::endl;
-            for (auto&& x : devices) {
-                auto properties = x.getProperties();
-                std::cout << counter++ << ": " << properties.deviceName << std::endl;
-            }
-            int select;
-            if (devices.size()>1) {
-                do {
-                    std::cout << "Input Your ID for selection [0-" << devices.size()-1 << "]:";
-                    std::cin >> select;
-                }
-                while (select<0 || select>=devices.size());
-                std::cout << "Device " << select << " selected, proceeding" << std::endl;
-            }
-            else {
-                std::cout << "Has only 1 device, auto select device 0" << std::endl;
-                select = 0;
-            }
-            return devices[select];
+
+        void Declare(Vulkan::Dependencies& deps) const override {
+            deps.Reads(WindowToken).Writes(PhysicalDeviceKey);
         }
+    private:
+        std::vector<const char*> _extensions;
     };
 
     class EnableWindow : public InitializeBuildStep {
@@ -84,6 +165,10 @@ namespace {
             GetResults(builder).WindowVk = Vulkan::Application::EnableWindow(_window);
             GetResults(builder).Window = std::move(_window);
         }
+
+        void Declare(Vulkan::Dependencies& deps) const override {
+            deps.Writes(WindowToken);
+        }
     private:
         std::shared_ptr<SDL::Window> _window;
     };
@@ -91,17 +176,24 @@ namespace {
     class QueueSelector : public InitializeBuildStep {
     public:
         void Build(Vulkan::Builder& builder) override {
-            Vulkan::Queues queues(builder.Fetch<vk::PhysicalDevice>(PhysicalDeviceName));
-            auto index = queues.GetGraphicsAndPresentFast(GetResults(builder).WindowVk->GetSurface());
-            static constexpr float priority = 0.1f;
-            std::vector<vk::DeviceQueueCreateInfo> queueInfos{
-                    vk::DeviceQueueCreateInfo(vk::DeviceQueueCreateFlags(), index.first, 1, &priority)
-            };
-            if (index.first!=index.second) {
-                queueInfos.emplace_back(vk::DeviceQueueCreateFlags(), index.second, 1, &priority);
-            }
-            builder.Push(DeviceQueueName, queueInfos);
-            builder.Push(QueueIndexName, index);
+            Vulkan::Queues queues(builder.Fetch(PhysicalDeviceKey));
+            builder.Push(QueueFamilyKey, queues.GetFamilies(GetResults(builder).WindowVk->GetSurface()));
+        }
+
+        void Declare(Vulkan::Dependencies& deps) const override {
+            deps.Reads(PhysicalDeviceKey).Reads(WindowToken).Writes(QueueFamilyKey);
+        }
+    };
+
+    class HeadlessQueueSelector : public InitializeBuildStep {
+    public:
+        void Build(Vulkan::Builder& builder) override {
+            Vulkan::Queues queues(builder.Fetch(PhysicalDeviceKey));
+            builder.Push(QueueFamilyKey, queues.GetHeadlessFamilies());
+        }
+
+        void Declare(Vulkan::Dependencies& deps) const override {
+            deps.Reads(PhysicalDeviceKey).Writes(QueueFamilyKey);
         }
     };
 
@@ -111,45 +203,102 @@ namespace {
                 :_extensions(std::move(extensions)) { }
 
         void Build(Vulkan::Builder& builder) override {
-            auto deviceQueues = builder.Fetch<std::vector<vk::DeviceQueueCreateInfo>>(DeviceQueueName);
-            GetResults(builder).Device =
-                    builder.Fetch<vk::PhysicalDevice>(PhysicalDeviceName).createDeviceUnique(
-                            {
-                                    {},
-                                    static_cast<uint32_t>(deviceQueues.size()), deviceQueues.data(),
-                                    0, nullptr,
-                                    static_cast<uint32_t>(_extensions.size()), _extensions.data()
-                            }
-                    );
+            auto& result = GetResults(builder);
+            const auto families = builder.Fetch(QueueFamilyKey);
+            const auto deviceQueues = families.GetCreateInfos();
+            result.PhysicalDevice = builder.Fetch(PhysicalDeviceKey);
+            // Only what the profiler can use, when the device has it
+            result.Features.pipelineStatisticsQuery = result.PhysicalDevice.getFeatures().pipelineStatisticsQuery;
+            // The uploader's copies reach the graphics queue through a timeline semaphore, see Vulkan::Uploader
+            vk::PhysicalDeviceTimelineSemaphoreFeatures timeline;
+            if (result.PhysicalDevice.getProperties().apiVersion >= VK_API_VERSION_1_2) {
+                timeline.timelineSemaphore = result.PhysicalDevice.getFeatures2<vk::PhysicalDeviceFeatures2,
+                        vk::PhysicalDeviceTimelineSemaphoreFeatures>()
+                        .get<vk::PhysicalDeviceTimelineSemaphoreFeatures>().timelineSemaphore;
+            }
+            result.TimelineSemaphores = timeline.timelineSemaphore;
+            vk::DeviceCreateInfo info(
+                    {},
+                    static_cast<uint32_t>(deviceQueues.size()), deviceQueues.data(),
+                    0, nullptr,
+                    static_cast<uint32_t>(_extensions.size()), _extensions.data(),
+                    &result.Features
+            );
+            if (result.TimelineSemaphores) info.pNext = &timeline;
+            result.Device = result.PhysicalDevice.createDeviceUnique(info);
+            result.GraphicsFamily = families.Graphics;
+            result.PresentFamily = families.Present;
+            result.ComputeFamily = families.Compute;
+            result.TransferFamily = families.Transfer;
+            result.GraphicsQueue = result.Device->getQueue(result.GraphicsFamily, 0);
+            result.PresentQueue = result.Device->getQueue(result.PresentFamily, 0);
+            result.ComputeQueue = result.Device->getQueue(result.ComputeFamily, 0);
+            result.TransferQueue = result.Device->getQueue(result.TransferFamily, 0);
+            std::cout << "Queue families: graphics " << families.Graphics << ", present " << families.Present
+                      << ", compute " << families.Compute << ", transfer " << families.Transfer << std::endl;
+            if (!result.TimelineSemaphores) {
+                std::cout << "No timeline semaphores, uploads retire on fences" << std::endl;
+            }
+            result.Allocator = std::make_unique<Vulkan::Allocator>(result.PhysicalDevice, result.Device.get());
+        }
+
+        void Declare(Vulkan::Dependencies& deps) const override {
+            deps.Reads(PhysicalDeviceKey).Reads(QueueFamilyKey).Writes(DeviceToken);
         }
     private:
         std::vector<const char*> _extensions;
     };
 
+    // What the swapchain trades: FIFO never tears and caps at the refresh rate, mailbox replaces queued images
+    // for lower latency without tearing, immediate presents at once and may tear. ImageCount 0 picks the
+    // minimum for FIFO and immediate and one more for mailbox, so it always has an image to render into
+    struct SwapChainSettings {
+        vk::PresentModeKHR PresentMode = vk::PresentModeKHR::eFifo;
+        uint32_t ImageCount = 0;
+    };
+
     class SwapChainBuilder : public InitializeBuildStep {
     public:
+        explicit SwapChainBuilder(SwapChainSettings settings = {}) noexcept
+                :_settings(settings) { }
+
         void Build(Vulkan::Builder& builder) override {
             auto& result = GetResults(builder);
             Setup(builder, result);
             auto surface = result.WindowVk->GetSurface();
             vk::Format format = result.SurfaceFormat = SelectFormat(surface);
-            SwapChain = Device.createSwapchainKHRUnique(BuildCreateInfo(surface, format));
+            auto createInfo = BuildCreateInfo(surface, format);
+            // Set when recreating, the presentation engine can keep showing its images until the new ones arrive
+            createInfo.oldSwapchain = result.SwapChain.get();
+            result.Extent = createInfo.imageExtent;
+            result.PresentMode = createInfo.presentMode;
+            std::cout << "Swapchain: " << vk::to_string(createInfo.presentMode) << ", "
+                      << createInfo.minImageCount << " images" << std::endl;
+            SwapChain = Device.createSwapchainKHRUnique(createInfo);
             BuildImageView(format);
-            result.SwapChain = std::move(SwapChain);
+            // Views of the retired swapchain go before its images
             result.ImageViews = std::move(ImageViews);
+            result.SwapChain = std::move(SwapChain);
+        }
+
+        void Declare(Vulkan::Dependencies& deps) const override {
+            deps.Reads(PhysicalDeviceKey).Reads(QueueFamilyKey).Reads(WindowToken).Reads(DeviceToken)
+                    .Writes(SurfaceToken);
         }
     private:
         void Setup(Vulkan::Builder& builder, const ResultPack& result) {
-            auto index = builder.Fetch<std::pair<size_t, size_t>>(QueueIndexName);
-            SetQueueIndex(index.first, index.second);
+            const auto families = builder.Fetch(QueueFamilyKey);
+            SetQueueIndex(families.Graphics, families.Present);
             Window = result.Window->GetHandleDangerous();
             Device = result.Device.get();
-            PhysicalDevice = builder.Fetch<vk::PhysicalDevice>(PhysicalDeviceName);
+            PhysicalDevice = builder.Fetch(PhysicalDeviceKey);
         }
 
         void SetQueueIndex(size_t graphics, size_t present) {
             graphicIndex = graphics;
             presentIndex = present;
+            queueFamilyIndices[0] = static_cast<uint32_t>(graphics);
+            queueFamilyIndices[1] = static_cast<uint32_t>(present);
         }
 
         VkExtent2D DefineExtent(const vk::SurfaceCapabilitiesKHR& capabilities) const {
@@ -199,18 +348,46 @@ namespace {
             // get the supported VkFormats
             const auto surfaceCapabilities = PhysicalDevice.getSurfaceCapabilitiesKHR(surface);
             const auto swapchainExtent = DefineExtent(surfaceCapabilities);
-            // The FIFO present mode is guaranteed by the spec to be supported
-            const auto swapchainPresentMode = vk::PresentModeKHR::eFifo;
+            const auto swapchainPresentMode = SelectPresentMode(surface);
+            const auto imageCount = SelectImageCount(surfaceCapabilities, swapchainPresentMode);
             const auto preTransform = SelectSurfaceTransform(surfaceCapabilities);
             const auto compositeAlpha = SelectCompositeAlpha(surfaceCapabilities);
             vk::SwapchainCreateInfoKHR swapChainCreateInfo(vk::SwapchainCreateFlagsKHR(), surface,
-                    surfaceCapabilities.minImageCount, format, vk::ColorSpaceKHR::eSrgbNonlinear,
+                    imageCount, format, vk::ColorSpaceKHR::eSrgbNonlinear,
                     swapchainExtent, 1, vk::ImageUsageFlagBits::eColorAttachment, vk::SharingMode::eExclusive, 0,
                     nullptr, preTransform, compositeAlpha, swapchainPresentMode, true, nullptr);
             AdjustCreateInfoByQueueConfiguration(swapChainCreateInfo);
             return swapChainCreateInfo;
         }
 
+        // The requested mode, else the other mode that does not wait for vblank, else FIFO which the spec
+        // guarantees
+        vk::PresentModeKHR SelectPresentMode(VkSurfaceKHR surface) const {
+            const auto supported = PhysicalDevice.getSurfacePresentModesKHR(surface);
+            const auto has = [&](vk::PresentModeKHR mode) {
+                return std::find(supported.begin(), supported.end(), mode) != supported.end();
+            };
+            const auto requested = _settings.PresentMode;
+            if (has(requested)) return requested;
+            if (requested == vk::PresentModeKHR::eMailbox && has(vk::PresentModeKHR::eImmediate)) {
+                return vk::PresentModeKHR::eImmediate;
+            }
+            if (requested == vk::PresentModeKHR::eImmediate && has(vk::PresentModeKHR::eMailbox)) {
+                return vk::PresentModeKHR::eMailbox;
+            }
+            return vk::PresentModeKHR::eFifo;
+        }
+
+        uint32_t SelectImageCount(const vk::SurfaceCapabilitiesKHR& capabilities, vk::PresentModeKHR mode) const {
+            auto count = _settings.ImageCount;
+            if (count == 0) {
+                count = capabilities.minImageCount + (mode == vk::PresentModeKHR::eMailbox ? 1 : 0);
+            }
+            count = std::max(count, capabilities.minImageCount);
+            // A maximum of zero means there is none
+            return capabilities.maxImageCount ? std::min(count, capabilities.maxImageCount) : count;
+        }
+
         vk::Format SelectFormat(VkSurfaceKHR surface) const {
             const auto formats = PhysicalDevice.getSurfaceFormatsKHR(surface);
             return (formats[0].format==vk::Format::eUndefined) ? vk::Format::eB8G8R8A8Unorm : formats[0].format;
@@ -222,7 +399,6 @@ namespace {
         }
 
         void AdjustCreateInfoByQueueConfiguration(vk::SwapchainCreateInfoKHR& swapChainCreateInfo) const {
-            uint32_t queueFamilyIndices[2] = {static_cast<uint32_t>(graphicIndex), static_cast<uint32_t>(presentIndex)};
             if (graphicIndex!=presentIndex) {
                 // If the graphics and present queues are from different queue families, we either have to explicitly transfer ownership of images between
                 // the queues, or we have to create the swapchain with imageSharingMode as VK_SHARING_MODE_CONCURRENT
@@ -232,49 +408,196 @@ namespace {
             }
         }
 
+        SwapChainSettings _settings;
         SDL_Window* Window{};
         vk::Device Device{};
         vk::UniqueSwapchainKHR SwapChain;
         std::vector<vk::UniqueImageView> ImageViews;
         vk::PhysicalDevice PhysicalDevice;
         size_t graphicIndex{}, presentIndex{};
+        // Referenced by the create info, so it has to outlive BuildCreateInfo
+        uint32_t queueFamilyIndices[2]{};
     };
 
     class RenderPassBuilder : public InitializeBuildStep {
     public:
+        explicit RenderPassBuilder(vk::ImageLayout finalLayout = vk::ImageLayout::ePresentSrcKHR) noexcept
+                :_finalLayout(finalLayout) { }
+
         void Build(Vulkan::Builder& builder) override {
             auto& results = GetResults(builder);
-            vk::AttachmentDescription attachmentDescriptions[2];
-            attachmentDescriptions[0] = vk::AttachmentDescription({}, results.SurfaceFormat,
-                    vk::SampleCountFlagBits::e1, vk::AttachmentLoadOp::eClear,
+            // The fullscreen pass writes every pixel, so neither a clear nor a depth buffer is needed
+            vk::AttachmentDescription attachmentDescription({}, results.SurfaceFormat,
+                    vk::SampleCountFlagBits::e1, vk::AttachmentLoadOp::eDontCare,
                     vk::AttachmentStoreOp::eStore, vk::AttachmentLoadOp::eDontCare, vk::AttachmentStoreOp::eDontCare,
-                    vk::ImageLayout::eUndefined, vk::ImageLayout::ePresentSrcKHR);
-            attachmentDescriptions[1] = vk::AttachmentDescription({}, vk::Format::eD16Unorm,
-                    vk::SampleCountFlagBits::e1, vk::AttachmentLoadOp::eClear,
-                    vk::AttachmentStoreOp::eDontCare, vk::AttachmentLoadOp::eDontCare, vk::AttachmentStoreOp::eDontCare,
-                    vk::ImageLayout::eUndefined, vk::ImageLayout::eDepthStencilAttachmentOptimal);
+                    vk::ImageLayout::eUndefined, _finalLayout);
 
             vk::AttachmentReference colorReference(0, vk::ImageLayout::eColorAttachmentOptimal);
-            vk::AttachmentReference depthReference(1, vk::ImageLayout::eDepthStencilAttachmentOptimal);
             vk::SubpassDescription subpass(vk::SubpassDescriptionFlags(), vk::PipelineBindPoint::eGraphics, 0, nullptr,
-                    1, &colorReference, nullptr, &depthReference);
+                    1, &colorReference);
+            // Wait for the presentation engine (or the previous use of an offscreen image) before writing
+            vk::SubpassDependency dependency(VK_SUBPASS_EXTERNAL, 0,
+                    vk::PipelineStageFlagBits::eColorAttachmentOutput, vk::PipelineStageFlagBits::eColorAttachmentOutput,
+                    {}, vk::AccessFlagBits::eColorAttachmentWrite);
             results.RenderPass = results.Device->createRenderPassUnique(
-                    vk::RenderPassCreateInfo(vk::RenderPassCreateFlags(), 2, attachmentDescriptions, 1, &subpass)
+                    vk::RenderPassCreateInfo(vk::RenderPassCreateFlags(), 1, &attachmentDescription, 1, &subpass,
+                            1, &dependency)
             );
         }
+
+        void Declare(Vulkan::Dependencies& deps) const override {
+            deps.Reads(DeviceToken).Reads(SurfaceToken).Writes(RenderPassToken);
+        }
+    private:
+        vk::ImageLayout _finalLayout;
+    };
+
+    class OffscreenTargetBuilder : public InitializeBuildStep {
+    public:
+        OffscreenTargetBuilder(vk::Extent2D extent, size_t count) noexcept
+                :_extent(extent), _count(count) { }
+
+        void Build(Vulkan::Builder& builder) override {
+            auto& result = GetResults(builder);
+            result.SurfaceFormat = vk::Format::eR8G8B8A8Unorm;
+            result.Extent = _extent;
+            for (size_t i = 0; i < _count; ++i) {
+                result.Offscreen.push_back(Vulkan::Resources::CreateImage2D(
+                        *result.Allocator, result.Device.get(), result.SurfaceFormat, _extent, 1,
+                        vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eTransferSrc));
+            }
+        }
+
+        void Declare(Vulkan::Dependencies& deps) const override {
+            deps.Reads(DeviceToken).Writes(SurfaceToken);
+        }
+    private:
+        vk::Extent2D _extent;
+        size_t _count;
+    };
+
+    class FramebufferBuilder : public InitializeBuildStep {
+    public:
+        void Build(Vulkan::Builder& builder) override {
+            auto& result = GetResults(builder);
+            result.Framebuffers.clear();
+            std::vector<vk::ImageView> views;
+            for (auto& x : result.ImageViews) views.push_back(x.get());
+            for (auto& x : result.Offscreen) views.push_back(x.View.get());
+            for (auto view : views) {
+                result.Framebuffers.push_back(result.Device->createFramebufferUnique(
+                        vk::FramebufferCreateInfo({}, result.RenderPass.get(), 1, &view,
+                                result.Extent.width, result.Extent.height, 1)));
+            }
+        }
+
+        void Declare(Vulkan::Dependencies& deps) const override {
+            deps.Reads(DeviceToken).Reads(SurfaceToken).Reads(RenderPassToken).Writes(FramebufferToken);
+        }
+    };
+
+    // The two ping-pong history targets and their render pass. Every accumulation pass leaves them in the shader
+    // read layout. Built again at the new extent on resize, the render pass is kept
+    class AccumulationTargetBuilder : public InitializeBuildStep {
+    public:
+        void Build(Vulkan::Builder& builder) override {
+            auto& result = GetResults(builder);
+            if (!result.AccumulationPass) BuildRenderPass(result);
+            for (size_t i = 0; i < result.Accumulation.size(); ++i) {
+                result.AccumulationFramebuffers[i].reset();
+                auto& target = result.Accumulation[i] = Vulkan::Resources::CreateImage2D(
+                        *result.Allocator, result.Device.get(), AccumulationFormat, result.Extent, 1,
+                        vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eSampled |
+                        vk::ImageUsageFlagBits::eTransferDst);
+                const auto view = target.View.get();
+                result.AccumulationFramebuffers[i] = result.Device->createFramebufferUnique(
+                        vk::FramebufferCreateInfo({}, result.AccumulationPass.get(), 1, &view,
+                                result.Extent.width, result.Extent.height, 1));
+            }
+        }
+
+        void Declare(Vulkan::Dependencies& deps) const override {
+            deps.Reads(DeviceToken).Reads(SurfaceToken).Writes(AccumulationToken);
+        }
+
+        static constexpr vk::Format AccumulationFormat = vk::Format::eR32G32B32A32Sfloat;
+    private:
+        static void BuildRenderPass(ResultPack& result) {
+            vk::AttachmentDescription attachmentDescription({}, AccumulationFormat,
+                    vk::SampleCountFlagBits::e1, vk::AttachmentLoadOp::eDontCare,
+                    vk::AttachmentStoreOp::eStore, vk::AttachmentLoadOp::eDontCare, vk::AttachmentStoreOp::eDontCare,
+                    vk::ImageLayout::eUndefined, vk::ImageLayout::eShaderReadOnlyOptimal);
+            vk::AttachmentReference colorReference(0, vk::ImageLayout::eColorAttachmentOptimal);
+            vk::SubpassDescription subpass(vk::SubpassDescriptionFlags(), vk::PipelineBindPoint::eGraphics, 0, nullptr,
+                    1, &colorReference);
+            const auto color = vk::PipelineStageFlagBits::eColorAttachmentOutput;
+            const auto fragment = vk::PipelineStageFlagBits::eFragmentShader;
+            vk::SubpassDependency dependencies[2] = {
+                    // The previous frame wrote the history we read and read the target we are about to overwrite
+                    {VK_SUBPASS_EXTERNAL, 0, color | fragment, fragment | color,
+                     vk::AccessFlagBits::eColorAttachmentWrite,
+                     vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eColorAttachmentWrite},
+                    // The present pass samples what we wrote
+                    {0, VK_SUBPASS_EXTERNAL, color, fragment,
+                     vk::AccessFlagBits::eColorAttachmentWrite, vk::AccessFlagBits::eShaderRead}
+            };
+            result.AccumulationPass = result.Device->createRenderPassUnique(
+                    vk::RenderPassCreateInfo({}, 1, &attachmentDescription, 1, &subpass, 2, dependencies));
+        }
     };
 
+    // Relative to the assets directory
+    constexpr const char* FinalVertexPath = "/shaders/Final.vsh";
+    constexpr const char* FinalPixelPath = "/shaders/Final.fsh";
+    constexpr const char* PresentPixelPath = "/shaders/Present.fsh";
+
+    Vulkan::ShaderLayout ReflectScene(const std::vector<unsigned int>& vertex,
+            const std::vector<unsigned int>& pixel) {
+        // FrameUniforms is a ring with a slot per frame in flight
+        return Vulkan::ShaderLayout().Add(vertex, vk::ShaderStageFlagBits::eVertex)
+                .Add(pixel, vk::ShaderStageFlagBits::eFragment).MakeDynamic("FrameUniforms");
+    }
+
+    Vulkan::ShaderLayout ReflectPresent(const std::vector<unsigned int>& vertex,
+            const std::vector<unsigned int>& pixel) {
+        return Vulkan::ShaderLayout().Add(vertex, vk::ShaderStageFlagBits::eVertex)
+                .Add(pixel, vk::ShaderStageFlagBits::eFragment);
+    }
+
+    // Kicks off compilation on the compiler's workers, every step ShaderCompile does not wait for overlaps with it
+    class ShaderCompileStart : public InitializeBuildStep {
+    public:
+        void Build(Vulkan::Builder& builder) override {
+            auto& compiler = Vulkan::Compiler::Instance();
+            builder.Push(VertexSpirvKey, SpirvFuture(compiler.CompileAsync(vk::ShaderStageFlagBits::eVertex,
+                    Utils::Assets::LoadFullText(FinalVertexPath))));
+            builder.Push(PixelSpirvKey, SpirvFuture(compiler.CompileAsync(vk::ShaderStageFlagBits::eFragment,
+                    Utils::Assets::LoadFullText(FinalPixelPath))));
+            builder.Push(PresentSpirvKey, SpirvFuture(compiler.CompileAsync(vk::ShaderStageFlagBits::eFragment,
+                    Utils::Assets::LoadFullText(PresentPixelPath))));
+        }
+
+        void Declare(Vulkan::Dependencies& deps) const override {
+            deps.Writes(VertexSpirvKey).Writes(PixelSpirvKey).Writes(PresentSpirvKey);
+        }
+    };
+
+    // Waits for the stages started by ShaderCompileStart, turns them into modules and reflects the resources
+    // they declare
     class ShaderCompile : public InitializeBuildStep {
     public:
         void Build(Vulkan::Builder& builder) override {
             auto& result = GetResults(builder);
             using C = Vulkan::Compiler;
-            C::Load();
             try {
-                result.Vertex = C::CreateModule(result.Device, C::CompileGlslang(vk::ShaderStageFlagBits::eVertex,
-                        Utils::Assets::LoadFullText("/shaders/Final.vsh")));
-                result.Pixel = C::CreateModule(result.Device, C::CompileGlslang(vk::ShaderStageFlagBits::eFragment,
-                        Utils::Assets::LoadFullText("/shaders/Final.fsh")));
+                const auto& vertex = builder.Fetch(VertexSpirvKey).get();
+                const auto& pixel = builder.Fetch(PixelSpirvKey).get();
+                const auto& present = builder.Fetch(PresentSpirvKey).get();
+                result.Vertex = C::CreateModule(result.Device.get(), vertex);
+                result.Pixel = C::CreateModule(result.Device.get(), pixel);
+                result.PresentPixel = C::CreateModule(result.Device.get(), present);
+                result.SceneShaders = ReflectScene(vertex, pixel);
+                result.PresentShaders = ReflectPresent(vertex, present);
             }
             catch (Vulkan::Compiler::GlslangCompileFailure& e) {
                 std::cout << "Shader Compile Failure:" << std::endl <<
@@ -286,40 +609,40 @@ namespace {
                           "info: " << e.what() << std::endl << "debug: " << e.debug() << std::endl;
                 throw Utils::Bailout();
             }
-            C::Unload();
+        }
+
+        void Declare(Vulkan::Dependencies& deps) const override {
+            deps.Reads(VertexSpirvKey).Reads(PixelSpirvKey).Reads(PresentSpirvKey).Reads(DeviceToken)
+                    .Writes(ShaderToken);
         }
     };
 
-    class PipelineBuilder : public InitializeBuildStep {
+    class PipelineCacheLoader : public InitializeBuildStep {
     public:
         void Build(Vulkan::Builder& builder) override {
             auto& result = GetResults(builder);
-            vk::DescriptorSetLayoutBinding descriptorSetLayoutBinding(0, vk::DescriptorType::eUniformBuffer, 1, vk::ShaderStageFlagBits::eVertex);
-            vk::UniqueDescriptorSetLayout descriptorSetLayout = result.Device->createDescriptorSetLayoutUnique(vk::DescriptorSetLayoutCreateInfo(vk::DescriptorSetLayoutCreateFlags(), 1, &descriptorSetLayoutBinding));
+            result.PipelineCache = std::make_unique<Vulkan::PipelineCache>(result.PhysicalDevice, result.Device.get());
+        }
 
-            // create a PipelineLayout using that DescriptorSetLayout
-            vk::UniquePipelineLayout pipelineLayout = result.Device->createPipelineLayoutUnique(vk::PipelineLayoutCreateInfo(vk::PipelineLayoutCreateFlags(), 1, &descriptorSetLayout.get()));
+        void Declare(Vulkan::Dependencies& deps) const override {
+            deps.Reads(DeviceToken).Writes(PipelineCacheToken);
+        }
+    };
 
+    // Shared pipeline state of the fullscreen passes: no vertex input, no depth, dynamic viewport and scissor
+    class FullscreenPipelineStep : public InitializeBuildStep {
+    public:
+        // Also used by the shader reloader, off the render thread
+        static vk::UniquePipeline CreatePipeline(const ResultPack& result, vk::ShaderModule vertex,
+                vk::ShaderModule pixel, vk::PipelineLayout layout, vk::RenderPass renderPass) {
             vk::PipelineShaderStageCreateInfo pipelineShaderStageCreateInfos[2] =
                     {
-                            vk::PipelineShaderStageCreateInfo({}, vk::ShaderStageFlagBits::eVertex, result.Vertex.get(), "main"),
-                            vk::PipelineShaderStageCreateInfo({}, vk::ShaderStageFlagBits::eFragment, result.Pixel.get(), "main")
+                            vk::PipelineShaderStageCreateInfo({}, vk::ShaderStageFlagBits::eVertex, vertex, "main"),
+                            vk::PipelineShaderStageCreateInfo({}, vk::ShaderStageFlagBits::eFragment, pixel, "main")
                     };
 
-            vk::VertexInputBindingDescription vertexInputBindingDescription(0, 4);//sizeof(coloredCubeData[0]));
-            vk::VertexInputAttributeDescription vertexInputAttributeDescriptions[2] =
-                    {
-                            vk::VertexInputAttributeDescription(0, 0, vk::Format::eR32G32B32A32Sfloat, 0),
-                            vk::VertexInputAttributeDescription(1, 0, vk::Format::eR32G32B32A32Sfloat, 16)
-                    };
-            vk::PipelineVertexInputStateCreateInfo pipelineVertexInputStateCreateInfo
-                    (
-                            vk::PipelineVertexInputStateCreateFlags(),  // flags
-                            1,                                          // vertexBindingDescriptionCount
-                            &vertexInputBindingDescription,             // pVertexBindingDescription
-                            2,                                          // vertexAttributeDescriptionCount
-                            vertexInputAttributeDescriptions            // pVertexAttributeDescriptions
-                    );
+            // Final.vsh generates the fullscreen quad from gl_VertexIndex, there is no vertex buffer
+            vk::PipelineVertexInputStateCreateInfo pipelineVertexInputStateCreateInfo;
 
             vk::PipelineInputAssemblyStateCreateInfo pipelineInputAssemblyStateCreateInfo(vk::PipelineInputAssemblyStateCreateFlags(), vk::PrimitiveTopology::eTriangleList);
 
@@ -331,7 +654,7 @@ namespace {
                             false,                                        // depthClampEnable
                             false,                                        // rasterizerDiscardEnable
                             vk::PolygonMode::eFill,                       // polygonMode
-                            vk::CullModeFlagBits::eBack,                  // cullMode
+                            vk::CullModeFlagBits::eNone,                  // cullMode
                             vk::FrontFace::eClockwise,                    // frontFace
                             false,                                        // depthBiasEnable
                             0.0f,                                         // depthBiasConstantFactor
@@ -342,19 +665,6 @@ namespace {
 
             vk::PipelineMultisampleStateCreateInfo pipelineMultisampleStateCreateInfo;
 
-            vk::StencilOpState stencilOpState(vk::StencilOp::eKeep, vk::StencilOp::eKeep, vk::StencilOp::eKeep, vk::CompareOp::eAlways);
-            vk::PipelineDepthStencilStateCreateInfo pipelineDepthStencilStateCreateInfo
-                    (
-                            vk::PipelineDepthStencilStateCreateFlags(), // flags
-                            true,                                       // depthTestEnable
-                            true,                                       // depthWriteEnable
-                            vk::CompareOp::eLessOrEqual,                // depthCompareOp
-                            false,                                      // depthBoundTestEnable
-                            false,                                      // stencilTestEnable
-                            stencilOpState,                             // front
-                            stencilOpState                              // back
-                    );
-
             vk::ColorComponentFlags colorComponentFlags(vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG | vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA);
             vk::PipelineColorBlendAttachmentState pipelineColorBlendAttachmentState
                     (
@@ -391,15 +701,257 @@ namespace {
                             &pipelineViewportStateCreateInfo,           // pViewportState
                             &pipelineRasterizationStateCreateInfo,      // pRasterizationState
                             &pipelineMultisampleStateCreateInfo,        // pMultisampleState
-                            &pipelineDepthStencilStateCreateInfo,       // pDepthStencilState
+                            nullptr,                                    // pDepthStencilState
                             &pipelineColorBlendStateCreateInfo,         // pColorBlendState
                             &pipelineDynamicStateCreateInfo,            // pDynamicState
-                            pipelineLayout.get(),                       // layout
-                            result.RenderPass.get()                            // renderPass
+                            layout,                                     // layout
+                            renderPass                                  // renderPass
                     );
 
-            result.Pipeline = result.Device->createGraphicsPipelineUnique(nullptr, graphicsPipelineCreateInfo);
+            const auto cache = result.PipelineCache ? result.PipelineCache->Get() : vk::PipelineCache();
+            const auto start = std::chrono::steady_clock::now();
+            auto pipeline = result.Device->createGraphicsPipelineUnique(cache, graphicsPipelineCreateInfo);
+            ReportCreationTime(result, std::chrono::steady_clock::now() - start);
+            return pipeline;
+        }
+    private:
+        template <class Duration>
+        static void ReportCreationTime(const ResultPack& result, Duration duration) {
+            std::cout << "Pipeline creation: " << std::chrono::duration<double, std::milli>(duration).count() << "ms (";
+            if (!result.PipelineCache) {
+                std::cout << "no cache";
+            }
+            else if (result.PipelineCache->IsWarm()) {
+                std::cout << "warm, " << result.PipelineCache->GetSeededSize() << " bytes seeded";
+            }
+            else {
+                std::cout << "cold";
+            }
+            std::cout << ")" << std::endl;
+        }
+    };
+
+    // Final.fsh, rendering into the accumulation targets
+    class PipelineBuilder : public FullscreenPipelineStep {
+    public:
+        void Build(Vulkan::Builder& builder) override {
+            auto& result = GetResults(builder);
+            const auto device = result.Device.get();
+            result.DescriptorSetLayout = result.SceneShaders.CreateSetLayout(device);
+            result.PipelineLayout = result.SceneShaders.CreatePipelineLayout(device, result.DescriptorSetLayout.get());
+            result.Pipeline = CreatePipeline(result, result.Vertex.get(), result.Pixel.get(),
+                    result.PipelineLayout.get(), result.AccumulationPass.get());
+        }
+
+        // Pipeline caches are internally synchronized, both pipelines can be created at once
+        void Declare(Vulkan::Dependencies& deps) const override {
+            deps.Reads(DeviceToken).Reads(ShaderToken).Reads(PipelineCacheToken).Reads(AccumulationToken)
+                    .Writes(ScenePipelineToken);
+        }
+    };
+
+    // Present.fsh, resolving the accumulation target into the swapchain or offscreen image
+    class PresentPipelineBuilder : public FullscreenPipelineStep {
+    public:
+        void Build(Vulkan::Builder& builder) override {
+            auto& result = GetResults(builder);
+            const auto device = result.Device.get();
+            result.PresentSetLayout = result.PresentShaders.CreateSetLayout(device);
+            result.PresentLayout = result.PresentShaders.CreatePipelineLayout(device, result.PresentSetLayout.get());
+            result.PresentPipeline = CreatePipeline(result, result.Vertex.get(), result.PresentPixel.get(),
+                    result.PresentLayout.get(), result.RenderPass.get());
+        }
+
+        void Declare(Vulkan::Dependencies& deps) const override {
+            deps.Reads(DeviceToken).Reads(ShaderToken).Reads(PipelineCacheToken).Reads(RenderPassToken)
+                    .Writes(PresentPipelineToken);
+        }
+    };
+
+    // Creates the resources Final.fsh reads. Needs nothing but the device, so noise generation and the octree
+    // build overlap with shader compilation and pipeline creation. The top of the octree is built from the same
+    // noise the textures hold
+    class SceneResourceBuilder : public InitializeBuildStep {
+    public:
+        explicit SceneResourceBuilder(uint32_t framesInFlight) noexcept
+                :_framesInFlight(framesInFlight) { }
+
+        void Build(Vulkan::Builder& builder) override {
+            auto& result = GetResults(builder);
+            auto& allocator = *result.Allocator;
+            auto device = result.Device.get();
+            const auto sampled = vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eTransferDst;
+            const vk::Extent2D noiseExtent(NoiseTextureSize, NoiseTextureSize);
+            result.NoiseTexture = Vulkan::Resources::CreateImage2D(allocator, device, vk::Format::eR32Sfloat,
+                    noiseExtent, 1, sampled);
+            result.MaxTexture = Vulkan::Resources::CreateImage2D(allocator, device, vk::Format::eR32Sfloat,
+                    noiseExtent, NoiseLevels + 1, sampled);
+            result.MinTexture = Vulkan::Resources::CreateImage2D(allocator, device, vk::Format::eR32Sfloat,
+                    noiseExtent, NoiseLevels + 1, sampled);
+            result.Uploads = std::make_unique<Vulkan::Uploader>(result.PhysicalDevice, device, allocator,
+                    result.TransferQueue, result.TransferFamily, Vulkan::Uploader::Consumer{result.GraphicsFamily,
+                            vk::AccessFlagBits::eShaderRead, vk::PipelineStageFlagBits::eFragmentShader},
+                    result.TimelineSemaphores);
+            Utils::ThreadPool workers;
+            auto maps = GenerateNoise(workers);
+            UploadNoise(result, maps);
+            UploadTree(result, BuildTree(Scene::Terrain(std::move(maps)), workers));
+            // The first frame acquires the scene like any later upload and waits for it on the device. The fence
+            // fallback only hands over what the host saw retire, so it has to wait here
+            const auto ticket = result.Uploads->Flush();
+            if (!result.Uploads->HasTimeline()) result.Uploads->Wait(ticket);
+            // Persistently mapped, each frame copies its uniforms into the slot of its frame ring slot
+            result.Uniforms = std::make_unique<Vulkan::FrameArena>(result.PhysicalDevice, device, allocator,
+                    _framesInFlight, sizeof(FrameUniforms), vk::BufferUsageFlagBits::eUniformBuffer);
+            result.Sampler = device.createSamplerUnique(vk::SamplerCreateInfo(
+                    {}, vk::Filter::eNearest, vk::Filter::eNearest, vk::SamplerMipmapMode::eNearest,
+                    vk::SamplerAddressMode::eClampToEdge, vk::SamplerAddressMode::eClampToEdge,
+                    vk::SamplerAddressMode::eClampToEdge, 0.0f, false, 1.0f, false, vk::CompareOp::eNever,
+                    0.0f, static_cast<float>(NoiseLevels), vk::BorderColor::eFloatTransparentBlack, false));
+            result.Allocator->Report(std::cout);
+        }
+
+        void Declare(Vulkan::Dependencies& deps) const override {
+            deps.Reads(DeviceToken).Writes(SceneResourceToken).Writes(TransferSubmitToken);
         }
     private:
+        static Scene::NoiseMaps GenerateNoise(Utils::ThreadPool& workers) {
+            const auto start = std::chrono::steady_clock::now();
+            auto maps = Scene::NoiseGenerator::Generate(NoiseLevels, Scene::NoiseGenerator::DefaultSeed, workers);
+            std::cout << "Noise generation: " << std::chrono::duration<double, std::milli>(
+                    std::chrono::steady_clock::now() - start).count() << "ms" << std::endl;
+            return maps;
+        }
+
+        // Whole mips, unless the transfer queue can copy them in bands of rows
+        static void UploadNoise(ResultPack& result, const Scene::NoiseMaps& maps) {
+            const std::pair<Vulkan::Image*, const Scene::MipChain*> uploads[] = {
+                    {&result.NoiseTexture, &maps.Noise},
+                    {&result.MaxTexture, &maps.Max},
+                    {&result.MinTexture, &maps.Min}
+            };
+            for (auto& [image, chain] : uploads) {
+                std::vector<Vulkan::Uploader::MipData> mips;
+                for (uint32_t mip = 0; mip < chain->GetMipCount(); ++mip) {
+                    const auto size = chain->GetSize(mip);
+                    mips.push_back({mip, vk::Extent2D(size, size), chain->GetData().data() + chain->GetOffset(mip)});
+                }
+                result.Uploads->Image(image->Handle.get(), image->MipLevels, sizeof(float), mips,
+                        vk::ImageLayout::eShaderReadOnlyOptimal);
+            }
+        }
+
+        static Scene::Octree BuildTree(const Scene::Terrain& terrain, Utils::ThreadPool& workers) {
+            const auto start = std::chrono::steady_clock::now();
+            auto tree = Scene::Octree::Build(terrain, Scene::Octree::DefaultLevels, workers);
+            std::cout << "Octree build: " << std::chrono::duration<double, std::milli>(
+                    std::chrono::steady_clock::now() - start).count() << "ms, " << tree.GetNodes().size()
+                    << " nodes over " << tree.GetLevels() << " levels" << std::endl;
+            return tree;
+        }
+
+        // Device local, the walk reads it for every step of every ray
+        static void UploadTree(ResultPack& result, const Scene::Octree& tree) {
+            const vk::DeviceSize bytes = tree.GetNodes().size() * sizeof(uint32_t);
+            result.TreeData = Vulkan::Resources::CreateBuffer(*result.Allocator, result.Device.get(), bytes,
+                    vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst,
+                    vk::MemoryPropertyFlagBits::eDeviceLocal);
+            result.Uploads->Buffer(result.TreeData.Handle.get(), 0, tree.GetNodes().data(), bytes);
+        }
+
+        uint32_t _framesInFlight;
     };
+
+    // Allocates the descriptor sets of both pipelines, AccumulationBinder fills them in
+    class DescriptorSetBuilder : public InitializeBuildStep {
+    public:
+        void Build(Vulkan::Builder& builder) override {
+            auto& result = GetResults(builder);
+            result.Descriptors = std::make_unique<Vulkan::DescriptorAllocator>(result.Device.get());
+            for (size_t i = 0; i < 2; ++i) {
+                result.DescriptorSets[i] = result.Descriptors->Allocate(result.SceneShaders,
+                        result.DescriptorSetLayout.get());
+                result.PresentSets[i] = result.Descriptors->Allocate(result.PresentShaders,
+                        result.PresentSetLayout.get());
+            }
+        }
+
+        void Declare(Vulkan::Dependencies& deps) const override {
+            deps.Reads(DeviceToken).Reads(ShaderToken).Reads(ScenePipelineToken).Reads(PresentPipelineToken)
+                    .Writes(DescriptorSetToken);
+        }
+    };
+
+    // Clears the accumulation targets and points the descriptor sets at the current resources. Runs after
+    // DescriptorSetBuilder and again whenever the targets are recreated
+    class AccumulationBinder : public InitializeBuildStep {
+    public:
+        void Build(Vulkan::Builder& builder) override {
+            auto& result = GetResults(builder);
+            ClearAccumulation(result);
+            WriteDescriptorSets(result);
+        }
+
+        void Declare(Vulkan::Dependencies& deps) const override {
+            deps.Reads(DeviceToken).Reads(ShaderToken).Reads(AccumulationToken).Reads(SceneResourceToken)
+                    .Writes(DescriptorSetToken).Writes(SubmitToken);
+        }
+    private:
+        static void ClearAccumulation(ResultPack& result) {
+            Vulkan::Commands::SubmitOnce(result.Device.get(), result.GraphicsQueue, result.GraphicsFamily,
+                    [&result](vk::CommandBuffer cmd) {
+                        for (auto image : {&result.Accumulation[0], &result.Accumulation[1]}) {
+                            Vulkan::Commands::TransitionImage(cmd, image->Handle.get(), image->MipLevels,
+                                    vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferDstOptimal,
+                                    {}, vk::AccessFlagBits::eTransferWrite,
+                                    vk::PipelineStageFlagBits::eTopOfPipe, vk::PipelineStageFlagBits::eTransfer);
+                            cmd.clearColorImage(image->Handle.get(), vk::ImageLayout::eTransferDstOptimal,
+                                    vk::ClearColorValue(std::array<float, 4>{0.0f, 0.0f, 0.0f, 0.0f}),
+                                    vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0,
+                                            image->MipLevels, 0, 1));
+                            Vulkan::Commands::TransitionImage(cmd, image->Handle.get(), image->MipLevels,
+                                    vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eShaderReadOnlyOptimal,
+                                    vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eShaderRead,
+                                    vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eFragmentShader);
+                        }
+                    });
+        }
+
+        // Bindings are looked up by the names Final.fsh and Present.fsh give them
+        static void WriteDescriptorSets(ResultPack& result) {
+            const auto layout = vk::ImageLayout::eShaderReadOnlyOptimal;
+            const auto sampler = result.Sampler.get();
+            const auto& scene = result.SceneShaders;
+            Vulkan::DescriptorWriter writer(result.Device.get());
+            for (size_t i = 0; i < 2; ++i) {
+                const auto set = result.DescriptorSets[i];
+                writer.Buffer(scene, set, "FrameUniforms", {result.Uniforms->GetBuffer(), 0, sizeof(FrameUniforms)})
+                        .Buffer(scene, set, "TreeData", {result.TreeData.Handle.get(), 0, VK_WHOLE_SIZE})
+                        .Image(scene, set, "NoiseTexture", {sampler, result.NoiseTexture.View.get(), layout})
+                        .Image(scene, set, "MaxTexture", {sampler, result.MaxTexture.View.get(), layout})
+                        .Image(scene, set, "MinTexture", {sampler, result.MinTexture.View.get(), layout})
+                        .Image(scene, set, "PrevFrame", {sampler, result.Accumulation[1 - i].View.get(), layout})
+                        .Image(result.PresentShaders, result.PresentSets[i], "Accumulated",
+                                {sampler, result.Accumulation[i].View.get(), layout});
+            }
+            writer.Flush();
+        }
+    };
+
+    // Rebuilds everything sized by the window after a resize or an out of date swapchain. The device, shader
+    // modules, pipelines (viewport and scissor are dynamic) and render passes are kept. Nothing recreated here
+    // may still be in use by the GPU
+    inline void RecreateSwapChain(const std::shared_ptr<ResultPack>& result, SwapChainSettings settings) {
+        result->Framebuffers.clear();
+        Vulkan::Builder()
+                .Push(ResultKey, result)
+                .Push(PhysicalDeviceKey, result->PhysicalDevice)
+                .Push(QueueFamilyKey, Vulkan::QueueFamilies{result->GraphicsFamily, result->PresentFamily,
+                        result->ComputeFamily, result->TransferFamily})
+                .Use<SwapChainBuilder>(settings)
+                .Use<FramebufferBuilder>()
+                .Use<AccumulationTargetBuilder>()
+                .Use<AccumulationBinder>()
+                .Build();
+    }
 }
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "initialize.h"
+#include "../vulkan/query.h"
+
+namespace {
+    // Passes of RecordFrame, as the GpuProfiler sees them
+    enum FramePass : uint32_t {
+        AccumulatePass = 0,
+        PresentPass = 1
+    };
+
+    Vulkan::GpuProfiler CreateProfiler(const ResultPack& result, uint32_t framesInFlight, bool enabled) {
+        std::vector<std::string> passes;
+        if (enabled) passes = {"accumulate", "present"};
+        return Vulkan::GpuProfiler(result.PhysicalDevice, result.Device.get(), result.GraphicsFamily,
+                result.Features.pipelineStatisticsQuery, framesInFlight, std::move(passes));
+    }
+
+    bool IsSrgb(vk::Format format) noexcept {
+        switch (format) {
+        case vk::Format::eR8G8B8A8Srgb:
+        case vk::Format::eB8G8R8A8Srgb:
+        case vk::Format::eA8B8G8R8SrgbPack32:
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    void RecordFullscreenPass(vk::CommandBuffer cmd, vk::RenderPass renderPass, vk::Framebuffer framebuffer,
+            vk::Extent2D extent, vk::Pipeline pipeline, vk::PipelineLayout layout, vk::DescriptorSet set,
+            const uint32_t* dynamicOffset = nullptr) {
+        const vk::Rect2D area({0, 0}, extent);
+        cmd.beginRenderPass(vk::RenderPassBeginInfo(renderPass, framebuffer, area), vk::SubpassContents::eInline);
+        cmd.bindPipeline(vk::PipelineBindPoint::eGraphics, pipeline);
+        cmd.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, layout, 0, 1, &set, dynamicOffset ? 1 : 0,
+                dynamicOffset);
+        cmd.setViewport(0, vk::Viewport(0.0f, 0.0f, static_cast<float>(extent.width),
+                static_cast<float>(extent.height), 0.0f, 1.0f));
+        cmd.setScissor(0, area);
+        cmd.draw(6, 1, 0, 0);
+        cmd.endRenderPass();
+    }
+
+    // Copies this frame's uniforms into the slot's part of the uniform ring, accumulates one more sample into
+    // Accumulation[target] and resolves that into the framebuffer of the given swapchain or offscreen image.
+    // The slot's previous frame must have retired and the profiler's frame has to be begun already
+    // Returns the hand-off the frame's submission waits on for the uploads it acquired
+    Vulkan::Handoff RecordFrame(vk::CommandBuffer cmd, const ResultPack& result, size_t image, uint32_t target,
+            const FrameUniforms& uniforms, Vulkan::GpuProfiler& profiler, uint32_t slot) {
+        // Streamed uploads flushed since the last frame, the submission waits for their copies on the device
+        const auto uploads = result.Uploads->Acquire(cmd);
+
+        // Host coherent, the submit makes the copy visible to the device
+        result.Uniforms->Begin(slot);
+        const auto uniformSlice = result.Uniforms->Allocate(sizeof(FrameUniforms));
+        std::memcpy(uniformSlice.Mapped, &uniforms, sizeof(FrameUniforms));
+        const auto uniformOffset = static_cast<uint32_t>(uniformSlice.Offset);
+
+        profiler.BeginPass(cmd, slot, AccumulatePass);
+        RecordFullscreenPass(cmd, result.AccumulationPass.get(), result.AccumulationFramebuffers[target].get(),
+                result.Extent, result.Pipeline.get(), result.PipelineLayout.get(), result.DescriptorSets[target],
+                &uniformOffset);
+        profiler.EndPass(cmd, slot, AccumulatePass);
+
+        PresentParameters parameters;
+        parameters.EncodeGamma = IsSrgb(result.SurfaceFormat) ? 0 : 1;
+        cmd.pushConstants(result.PresentLayout.get(), vk::ShaderStageFlagBits::eFragment, 0, sizeof(parameters),
+                &parameters);
+        profiler.BeginPass(cmd, slot, PresentPass);
+        RecordFullscreenPass(cmd, result.RenderPass.get(), result.Framebuffers[image].get(), result.Extent,
+                result.PresentPipeline.get(), result.PresentLayout.get(), result.PresentSets[target]);
+        profiler.EndPass(cmd, slot, PresentPass);
+        return uploads;
+    }
+}
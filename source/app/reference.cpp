@@ -0,0 +1,97 @@
+#include "reference.h"
+#include "uniforms.h"
+#include "../scene/tracer.h"
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+namespace {
+    // Every CheckStride-th pixel of the first frame goes through the scalar path as well
+    constexpr size_t CheckStride = 61;
+
+    void CheckAgainstScalar(const Scene::Tracer& tracer, const Scene::TraceParameters& parameters,
+            const std::vector<float>& rgba, ReferenceStatistics& stats) {
+        Scene::TraceStatistics ignored;
+        const auto pixels = size_t(parameters.Width) * parameters.Height;
+        for (size_t i = 0; i < pixels; i += CheckStride) {
+            const auto x = static_cast<uint32_t>(i % parameters.Width), y = static_cast<uint32_t>(i / parameters.Width);
+            const auto color = tracer.TracePixel(parameters, x, y, ignored);
+            const float expected[3] = {color.X, color.Y, color.Z};
+            ++stats.Checked;
+            if (std::memcmp(expected, &rgba[i * 4], sizeof(expected)) != 0) ++stats.Mismatches;
+        }
+    }
+
+    // Before / after numbers for the resuming traversal on the profiler view, which must not change the image
+    void CompareTraversals(const Scene::Tracer& tracer, Scene::TraceParameters parameters,
+            Utils::ThreadPool& workers, ReferenceStatistics& stats) {
+        using Clock = std::chrono::steady_clock;
+        std::vector<float> images[2];
+        ReferenceStatistics::TraversalRun* runs[2] = {&stats.Restart, &stats.Resume};
+        const Scene::Traversal modes[2] = {Scene::Traversal::Restart, Scene::Traversal::Resume};
+        for (int i = 0; i < 2; ++i) {
+            parameters.Traversal = modes[i];
+            const auto start = Clock::now();
+            const auto traced = tracer.Render(parameters, images[i], workers);
+            runs[i]->Milliseconds = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+            runs[i]->Steps = traced.Steps;
+            runs[i]->Nodes = traced.Nodes;
+        }
+        stats.TraversalsDiffer = images[0] != images[1];
+    }
+}
+
+bool Reference_Renderer::RunSecure(const HeadlessOptions& options, FrameTimings& timings,
+        ReferenceStatistics& stats) noexcept {
+    try {
+        timings = Run(options, stats);
+        return true;
+    }
+    catch (std::exception& err) {
+        std::cout << typeid(err).name() << ": " << err.what() << std::endl;
+    }
+    catch (...) {
+        std::cout << "unknown error" << std::endl;
+    }
+    std::cout << "Abnormal Reference Render Exit" << std::endl;
+    return false;
+}
+
+FrameTimings Reference_Renderer::Run(const HeadlessOptions& options, ReferenceStatistics& stats) {
+    Utils::ThreadPool workers;
+    const Scene::Terrain terrain(Scene::NoiseGenerator::Generate(Scene::NoiseLevels,
+            Scene::NoiseGenerator::DefaultSeed, workers));
+    const Scene::Tracer tracer(terrain);
+    std::cout << "CPU reference renderer on " << workers.GetThreadCount() << " threads" << std::endl;
+
+    Scene::TraceParameters parameters;
+    parameters.Width = options.Width;
+    parameters.Height = options.Height;
+    parameters.PathTracing = options.PathTracing;
+    const auto camera = FrameUniforms().CameraPosition; // The view the GPU renderers start from
+    parameters.CameraPosition = {camera[0], camera[1], camera[2]};
+    std::vector<float> rgba;
+    FrameTimings timings;
+    using Clock = std::chrono::steady_clock;
+    for (uint32_t frame = 0; frame < options.Frames; ++frame) {
+        parameters.RandomSeed = static_cast<float>(frame % (1u << 24u)); // Same seeds as Accumulation
+        if (!options.Poses.empty()) {
+            const auto& pose = options.Poses[frame % options.Poses.size()];
+            parameters.CameraPosition = {pose.Position[0], pose.Position[1], pose.Position[2]};
+            parameters.ModelViewInverse = pose.GetRotation();
+        }
+        const auto start = Clock::now();
+        const auto frameStats = tracer.Render(parameters, rgba, workers);
+        const auto ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        timings.Milliseconds.push_back(ms);
+        timings.TotalMilliseconds += ms;
+        stats.Rays += frameStats.Rays;
+        stats.Steps += frameStats.Steps;
+        stats.Nodes += frameStats.Nodes;
+        if (frame == 0) CheckAgainstScalar(tracer, parameters, rgba, stats);
+        if (frame == 0 && !parameters.PathTracing) CompareTraversals(tracer, parameters, workers, stats);
+    }
+    stats.Seconds = timings.TotalMilliseconds / 1000.0;
+    return timings;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <utility>
+#include <cstdint>
+#include <ostream>
+#include "headless.h"
+
+struct ReferenceStatistics {
+    uint64_t Rays{};
+    uint64_t Steps{};
+    uint64_t Nodes{};
+    double Seconds{};
+    // Pixels of the first frame re-traced through the scalar path, and how many of them differed
+    uint64_t Checked{};
+    uint64_t Mismatches{};
+    // The first profiler frame traced once per traversal, before (restart) and after (resume)
+    struct TraversalRun {
+        uint64_t Steps{};
+        uint64_t Nodes{};
+        double Milliseconds{};
+    } Restart, Resume;
+    bool TraversalsDiffer = false;
+
+    void Report(std::ostream& out) const {
+        out << "rays: " << Rays << ", rays/s: " << (Seconds > 0.0 ? Rays / Seconds : 0.0)
+            << ", steps/ray: " << (Rays ? double(Steps) / Rays : 0.0)
+            << ", nodes/step: " << (Steps ? double(Nodes) / Steps : 0.0)
+            << ", scalar mismatches: " << Mismatches << "/" << Checked << std::endl;
+        if (!Restart.Steps) return;
+        for (auto [name, run] : {std::pair{"restart", &Restart}, std::pair{"resume", &Resume}}) {
+            out << name << " traversal: " << run->Steps << " steps, " << run->Nodes << " nodes, "
+                << double(run->Nodes) / run->Steps << " nodes/step, " << run->Milliseconds << "ms" << std::endl;
+        }
+        out << "traversal images " << (TraversalsDiffer ? "differ" : "match") << std::endl;
+    }
+};
+
+// Renders the same frames as Headless_Renderer with the CPU port of Final.fsh, for machines without a usable
+// Vulkan device and as a reference for the shader
+class Reference_Renderer {
+public:
+    bool RunSecure(const HeadlessOptions& options, FrameTimings& timings, ReferenceStatistics& stats) noexcept;
+private:
+    FrameTimings Run(const HeadlessOptions& options, ReferenceStatistics& stats);
+};
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <deque>
+#include <future>
+#include <iostream>
+#include "initialize.h"
+#include "../util/watcher.h"
+
+namespace {
+    // Rebuilds the fullscreen pipelines when a shader in assets/shaders changes. Compiling and pipeline creation
+    // run on a background thread, the render thread only swaps the result in between frames and destroys the
+    // replaced pipelines once the frames that used them have retired. A shader that fails to compile, or whose
+    // resources no longer match the descriptor sets, is reported and the running pipelines are kept
+    class ShaderReloader {
+    public:
+        // Shaders read from the asset pack can not change, only loose files are watched
+        explicit ShaderReloader(bool enabled)
+                :_watcher(enabled && !Utils::Assets::IsPacked() ? Utils::Assets::GetDirectory() + "/shaders"
+                        : std::string()) {
+            if (_watcher.IsEnabled()) {
+                std::cout << "Watching shaders for changes" << std::endl;
+            }
+            else if (enabled) {
+                std::cout << "Shaders come from the asset pack, set VXRT_ASSET_DIR to hot reload them" << std::endl;
+            }
+        }
+
+        ShaderReloader(const ShaderReloader&) = delete;
+
+        ShaderReloader& operator=(const ShaderReloader&) = delete;
+
+        // Waits for a reload still compiling, it may be using the device
+        ~ShaderReloader() {
+            if (_pending.valid()) _pending.wait();
+        }
+
+        // Call between frames, `frame` being the number of frames acquired from the ring so far
+        void Update(ResultPack& result, uint64_t frame, uint32_t framesInFlight) {
+            while (!_retired.empty() && frame >= _retired.front().Frame + framesInFlight) _retired.pop_front();
+            for (const auto& name : _watcher.Poll()) {
+                if (IsShader(name)) _dirty = true;
+            }
+            if (_pending.valid()) {
+                if (_pending.wait_for(std::chrono::seconds(0)) != std::future_status::ready) return;
+                Swap(result, frame);
+            }
+            // Changes made while compiling start another round, so the last save always wins
+            if (_dirty) {
+                _dirty = false;
+                _pending = std::async(std::launch::async, Rebuild, std::cref(result));
+            }
+        }
+    private:
+        struct Pipelines {
+            vk::UniqueShaderModule Vertex, Pixel, PresentPixel;
+            vk::UniquePipeline Pipeline, PresentPipeline;
+        };
+
+        struct Retired {
+            uint64_t Frame;
+            Pipelines Objects;
+        };
+
+        VXRT_EXCEPTION(LayoutChanged, "Shader resources changed, restart to pick them up")
+
+        static bool IsShader(const std::string& name) {
+            const auto dot = name.rfind('.');
+            const auto extension = dot == std::string::npos ? std::string() : name.substr(dot);
+            return extension == ".vsh" || extension == ".fsh";
+        }
+
+        // Off the render thread. Reads only what stays fixed while rendering: the device, the pipeline cache,
+        // the render passes, the layouts and the reflected resources
+        static Pipelines Rebuild(const ResultPack& result) {
+            using C = Vulkan::Compiler;
+            const auto vertex = C::Compile(vk::ShaderStageFlagBits::eVertex,
+                    Utils::Assets::LoadFullText(FinalVertexPath));
+            const auto pixel = C::Compile(vk::ShaderStageFlagBits::eFragment,
+                    Utils::Assets::LoadFullText(FinalPixelPath));
+            const auto present = C::Compile(vk::ShaderStageFlagBits::eFragment,
+                    Utils::Assets::LoadFullText(PresentPixelPath));
+            if (!ReflectScene(vertex, pixel).IsCompatible(result.SceneShaders) ||
+                !ReflectPresent(vertex, present).IsCompatible(result.PresentShaders)) {
+                throw LayoutChanged();
+            }
+            const auto device = result.Device.get();
+            Pipelines fresh;
+            fresh.Vertex = C::CreateModule(device, vertex);
+            fresh.Pixel = C::CreateModule(device, pixel);
+            fresh.PresentPixel = C::CreateModule(device, present);
+            fresh.Pipeline = FullscreenPipelineStep::CreatePipeline(result, fresh.Vertex.get(), fresh.Pixel.get(),
+                    result.PipelineLayout.get(), result.AccumulationPass.get());
+            fresh.PresentPipeline = FullscreenPipelineStep::CreatePipeline(result, fresh.Vertex.get(),
+                    fresh.PresentPixel.get(), result.PresentLayout.get(), result.RenderPass.get());
+            return fresh;
+        }
+
+        void Swap(ResultPack& result, uint64_t frame) {
+            Pipelines fresh;
+            try {
+                fresh = _pending.get();
+            }
+            catch (Vulkan::Compiler::GlslangFailure& e) {
+                std::cout << "Shader reload failed, keeping the running pipelines:" << std::endl << e.what()
+                          << std::endl;
+                return;
+            }
+            catch (std::exception& e) {
+                std::cout << "Shader reload failed, keeping the running pipelines: " << e.what() << std::endl;
+                return;
+            }
+            // Frames up to frame - 1 may still use what is swapped out
+            std::swap(result.Vertex, fresh.Vertex);
+            std::swap(result.Pixel, fresh.Pixel);
+            std::swap(result.PresentPixel, fresh.PresentPixel);
+            std::swap(result.Pipeline, fresh.Pipeline);
+            std::swap(result.PresentPipeline, fresh.PresentPipeline);
+            _retired.push_back({frame, std::move(fresh)});
+            std::cout << "Shaders reloaded" << std::endl;
+        }
+
+        Utils::FileWatcher _watcher;
+        bool _dirty = false;
+        std::future<Pipelines> _pending;
+        std::deque<Retired> _retired;
+    };
+}
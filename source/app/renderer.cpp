@@ -1,17 +1,155 @@
 #include "renderer.h"
-#include "initialize.h"
-
-void Vulkan_Renderer::Setup(SDL::Window& window) {
-    auto result = std::make_shared<ResultPack>();
-    Vulkan::Builder()
-            .Push(ResultName, result)
-            .Use<ConsoleDeviceSelector>()
-            .Use<EnableWindow>(window.GetReference())
-            .Use<QueueSelector>()
-            .Use<DeviceCreator>(std::vector<const char*>({VK_KHR_SWAPCHAIN_EXTENSION_NAME}))
-            .Use<SwapChainBuilder>()
-            .Use<RenderPassBuilder>()
-            .Use<ShaderCompile>()
-            .Use<PipelineBuilder>()
-            .Build();
-}
\ No newline at end of file
+#include "passes.h"
+#include "accumulation.h"
+#include "reload.h"
+#include "../vulkan/frame.h"
+#include "../util/pacer.h"
+#include "../util/rolling.h"
+
+#include <chrono>
+#include <thread>
+
+namespace {
+    constexpr uint64_t ProfileReportFrames = 600;
+
+    std::shared_ptr<ResultPack> Setup(SDL::Window& window, const RenderOptions& options) {
+        auto result = std::make_shared<ResultPack>();
+        const std::vector<const char*> extensions{VK_KHR_SWAPCHAIN_EXTENSION_NAME};
+        Vulkan::Builder()
+                .Push(ResultKey, result)
+                .Use<ShaderCompileStart>()
+                .Use<EnableWindow>(window.GetReference())
+                .Use<PhysicalDeviceSelector>(extensions)
+                .Use<QueueSelector>()
+                .Use<DeviceCreator>(extensions)
+                .Use<SwapChainBuilder>(SwapChainSettings{options.PresentMode, options.SwapChainImages})
+                .Use<RenderPassBuilder>()
+                .Use<FramebufferBuilder>()
+                .Use<AccumulationTargetBuilder>()
+                .Use<ShaderCompile>()
+                .Use<PipelineCacheLoader>()
+                .Use<PipelineBuilder>()
+                .Use<PresentPipelineBuilder>()
+                .Use<SceneResourceBuilder>(options.FramesInFlight)
+                .Use<DescriptorSetBuilder>()
+                .Use<AccumulationBinder>()
+                .Build().Print(std::cout);
+        return result;
+    }
+
+    // P switches between path tracing and the march step view, R restarts the accumulation
+    void HandleInput(const SDL_Event& event, bool& pathTracing, Accumulation& accumulation) noexcept {
+        if (event.type != SDL_KEYDOWN || event.key.repeat) return;
+        switch (event.key.keysym.sym) {
+            case SDLK_p: pathTracing = !pathTracing; break;
+            case SDLK_r: accumulation.Reset(); break;
+            default: break;
+        }
+    }
+
+    // imagesInFlight remembers the fence of the frame that last rendered into each swapchain image, since
+    // the presentation engine may hand images back in any order and their count differs from the frame count.
+    // Returns false when the swapchain no longer matches the surface and has to be recreated
+    bool RenderFrame(ResultPack& result, Vulkan::FrameRing& frames, std::vector<vk::Fence>& imagesInFlight,
+            Vulkan::GpuProfiler& profiler, const FrameUniforms& uniforms, uint32_t target) {
+        auto& slot = frames.Acquire();
+        const auto device = result.Device.get();
+        uint32_t image;
+        bool suboptimal;
+        try {
+            const auto acquired = device.acquireNextImageKHR(result.SwapChain.get(),
+                    std::numeric_limits<uint64_t>::max(), slot.ImageAcquired.get(), nullptr);
+            image = acquired.value;
+            suboptimal = acquired.result == vk::Result::eSuboptimalKHR;
+        }
+        catch (vk::OutOfDateKHRError&) {
+            // Nothing was submitted, the slot's fence is still signaled and its semaphore unsignaled
+            return false;
+        }
+        if (imagesInFlight[image] && imagesInFlight[image] != slot.Fence.get()) {
+            device.waitForFences(imagesInFlight[image], true, std::numeric_limits<uint64_t>::max());
+        }
+        imagesInFlight[image] = slot.Fence.get();
+
+        profiler.BeginFrame(slot.Commands, slot.Index, frames.GetFrameNumber() - 1);
+        const auto uploads = RecordFrame(slot.Commands, result, image, target, uniforms, profiler, slot.Index);
+        frames.Submit(result.GraphicsQueue, slot, {{slot.ImageAcquired.get(),
+                vk::PipelineStageFlagBits::eColorAttachmentOutput, slot.RenderFinished.get()}, uploads});
+
+        const auto swapChain = result.SwapChain.get();
+        const auto renderFinished = slot.RenderFinished.get();
+        try {
+            const auto presented = result.PresentQueue.presentKHR(
+                    vk::PresentInfoKHR(1, &renderFinished, 1, &swapChain, &image));
+            return !suboptimal && presented != vk::Result::eSuboptimalKHR;
+        }
+        catch (vk::OutOfDateKHRError&) {
+            return false;
+        }
+    }
+}
+
+void Vulkan_Renderer::RenderThread(SDL::Window& window) {
+    auto result = Setup(window, _options);
+    // Before the ring, so pipelines it retires outlive the ring's final wait
+    ShaderReloader reloader(_options.HotReload);
+    Vulkan::FrameRing frames(result->Device.get(), result->GraphicsFamily, _options.FramesInFlight);
+    std::vector<vk::Fence> imagesInFlight(result->Framebuffers.size());
+    auto profiler = CreateProfiler(*result, frames.GetFramesInFlight(), _options.GpuProfile);
+    if (!_options.GpuProfileCsv.empty()) profiler.OpenCsv(_options.GpuProfileCsv);
+    Accumulation accumulation;
+    // FIFO already waits for vblank
+    Utils::FramePacer pacer;
+    if (_options.FramePacing && result->PresentMode != vk::PresentModeKHR::eFifo) pacer.SetRate(_refreshRate.load());
+    const auto start = std::chrono::steady_clock::now();
+    const SwapChainSettings settings{_options.PresentMode, _options.SwapChainImages};
+    bool pathTracing = _options.PathTracing;
+    // From the event that moved the camera to the first frame recorded with it, in milliseconds
+    Utils::RollingStatistics cameraLatency;
+    uint64_t cameraSequence = 0;
+    bool recreate = false;
+    while (!_stop.load()) {
+        if (window.GetFlags() & SDL_WINDOW_MINIMIZED) {
+            // A minimized surface has a zero extent, no swapchain can be created for it
+            std::this_thread::sleep_for(std::chrono::milliseconds(16));
+            continue;
+        }
+        if (recreate || _resized.exchange(false)) {
+            // Only our own frames have to retire, the device keeps running
+            frames.WaitIdle();
+            result->PresentQueue.waitIdle();
+            RecreateSwapChain(result, settings);
+            imagesInFlight.assign(result->Framebuffers.size(), vk::Fence());
+            accumulation.Reset();
+            recreate = false;
+        }
+        reloader.Update(*result, frames.GetFrameNumber(), frames.GetFramesInFlight());
+        pacer.Wait();
+        // After the pacer, so the frame sees input that arrived while it waited
+        _input.Drain([&](const SDL_Event& event) { HandleInput(event, pathTracing, accumulation); });
+        FrameUniforms uniforms;
+        uniforms.FrameWidth = static_cast<int32_t>(result->Extent.width);
+        uniforms.FrameHeight = static_cast<int32_t>(result->Extent.height);
+        uniforms.PathTracing = pathTracing ? 1 : 0;
+        uniforms.Time = std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count();
+        // The newest pose, extrapolated to the moment the frame is recorded
+        const auto now = CameraState::Clock::now();
+        const auto& camera = _camera.Read();
+        uniforms.SetCamera(camera.At(now));
+        if (camera.Sequence != cameraSequence) {
+            cameraSequence = camera.Sequence;
+            cameraLatency.Push(std::chrono::duration<double, std::milli>(now - camera.Timestamp).count());
+        }
+        accumulation.Advance(uniforms);
+        recreate = !RenderFrame(*result, frames, imagesInFlight, profiler, uniforms, accumulation.GetWriteIndex());
+        if (profiler.IsEnabled() && frames.GetFrameNumber() % ProfileReportFrames == 0) {
+            profiler.Report(std::cout);
+            if (cameraLatency.GetCount()) {
+                std::cout << "Camera input to record: " << cameraLatency.Average() << "ms average, "
+                          << cameraLatency.Percentile(0.99) << "ms p99" << std::endl;
+            }
+        }
+    }
+    result->Device->waitIdle();
+    profiler.Flush();
+}
@@ -1,12 +1,30 @@
 #pragma once
 
+#include <atomic>
+#include <string>
 #include <iostream>
 #include <algorithm>
+#include "controller.h"
 #include "../sdl/window.h"
+#include "../util/spsc.h"
 #include <vulkan/vulkan.hpp>
 
+struct RenderOptions {
+    uint32_t FramesInFlight = 2;
+    bool PathTracing = true; // false renders the march step profiler instead
+    bool GpuProfile = false; // Per pass GPU timings, logged every ProfileReportFrames frames
+    std::string GpuProfileCsv; // Also written here when not empty
+    vk::PresentModeKHR PresentMode = vk::PresentModeKHR::eFifo; // Falls back to what the surface supports
+    uint32_t SwapChainImages = 0; // 0 lets the present mode decide
+    bool FramePacing = false; // Caps modes that do not wait for vblank at the display refresh rate
+    bool HotReload = true; // Rebuilds the pipelines whenever a shader in the assets directory changes
+};
+
 class Vulkan_Renderer {
 public:
+    explicit Vulkan_Renderer(RenderOptions options = {}) noexcept
+            :_options(options) { }
+
     void RenderThreadSecure(SDL::Window& window) noexcept {
         try {
             RenderThread(window);
@@ -25,11 +43,32 @@ public:
         }
         std::cout << "Abnormal Render Exit, Initiate Exit Cleanup" << std::endl;
     }
-private:
-    void RenderThread(SDL::Window& window) {
-        Setup(window);
-        //CreateRenderPass();
+
+    // Asks the frame loop to finish the frame it is recording and leave, safe to call from any thread
+    void Stop() noexcept { _stop = true; }
+
+    // The swapchain is recreated before the next frame, safe to call from any thread
+    void NotifyResized() noexcept { _resized = true; }
+
+    // Main thread only. Moves the camera at once, the event itself reaches the render thread right before it
+    // records its next frame and is dropped when the render thread fell InputQueueSize events behind
+    void PushInput(const SDL_Event& event) noexcept {
+        _camera.Handle(event);
+        _input.TryPush(event);
     }
 
-    void Setup(SDL::Window& window);
-};
\ No newline at end of file
+    // Of the display the window is on, queried on the main thread before the render thread starts. Zero when
+    // unknown, which disables pacing
+    void SetRefreshRate(int hz) noexcept { _refreshRate = hz; }
+private:
+    static constexpr size_t InputQueueSize = 256;
+
+    void RenderThread(SDL::Window& window);
+
+    std::atomic_bool _stop {false};
+    std::atomic_bool _resized {false};
+    std::atomic_int _refreshRate {0};
+    RenderOptions _options;
+    Utils::SpscQueue<SDL_Event, InputQueueSize> _input;
+    CameraController _camera;
+};
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstddef>
+#include <type_traits>
+#include "camera.h"
+
+namespace {
+    constexpr uint32_t NoiseLevels = 8u; // Matches NoiseLevels in Final.fsh
+    constexpr uint32_t NoiseTextureSize = 1u << NoiseLevels;
+
+    using Mat4 = std::array<float, 16>;
+
+    constexpr Mat4 Identity {
+            1.0f, 0.0f, 0.0f, 0.0f,
+            0.0f, 1.0f, 0.0f, 0.0f,
+            0.0f, 0.0f, 1.0f, 0.0f,
+            0.0f, 0.0f, 0.0f, 1.0f
+    };
+
+    // Mirrors the std140 FrameUniforms block in Final.fsh
+    struct FrameUniforms {
+        Mat4 ProjectionMatrix = Identity;
+        Mat4 ModelViewMatrix = Identity;
+        Mat4 ProjectionInverse = Identity;
+        Mat4 ModelViewInverse = Identity;
+        std::array<float, 3> CameraPosition {0.0f, 20.0f, 0.0f}; // Above the highest peaks of the generated terrain
+        float RandomSeed = 0.0f;
+        float NoiseTextureSize = static_cast<float>(1u << NoiseLevels);
+        float _pad0 = 0.0f;
+        std::array<float, 2> NoiseOffset {};
+        float Time = 0.0f;
+
+        int32_t PathTracing = 0;
+        int32_t SampleCount = 0;
+        int32_t FrameWidth = 0;
+        int32_t FrameHeight = 0;
+        int32_t FrameBufferSize = 0;
+        int32_t _pad1[2] {};
+
+        void SetCamera(const CameraPose& pose) noexcept {
+            CameraPosition = pose.Position;
+            ModelViewMatrix = pose.GetView();
+            ModelViewInverse = pose.GetRotation();
+        }
+    };
+
+    // std140 puts the vec3 and every matrix on 16 bytes and the vec2 on 8, the rest packs on 4
+    static_assert(std::is_standard_layout_v<FrameUniforms>, "FrameUniforms is copied into the uniform ring as is");
+    static_assert(offsetof(FrameUniforms, ProjectionMatrix) == 0);
+    static_assert(offsetof(FrameUniforms, ModelViewMatrix) == 64);
+    static_assert(offsetof(FrameUniforms, ProjectionInverse) == 128);
+    static_assert(offsetof(FrameUniforms, ModelViewInverse) == 192);
+    static_assert(offsetof(FrameUniforms, CameraPosition) == 256);
+    static_assert(offsetof(FrameUniforms, RandomSeed) == 268);
+    static_assert(offsetof(FrameUniforms, NoiseTextureSize) == 272);
+    static_assert(offsetof(FrameUniforms, NoiseOffset) == 280);
+    static_assert(offsetof(FrameUniforms, Time) == 288);
+    static_assert(offsetof(FrameUniforms, PathTracing) == 292);
+    static_assert(offsetof(FrameUniforms, SampleCount) == 296);
+    static_assert(offsetof(FrameUniforms, FrameWidth) == 300);
+    static_assert(offsetof(FrameUniforms, FrameHeight) == 304);
+    static_assert(offsetof(FrameUniforms, FrameBufferSize) == 308);
+    static_assert(sizeof(FrameUniforms) % 16 == 0);
+
+    // Push constants of Present.fsh
+    struct PresentParameters {
+        float Exposure = 1.0f;
+        int32_t EncodeGamma = 1;
+    };
+}
@@ -1,26 +1,142 @@
 #include <thread>
+#include <string>
+#include <cstdio>
 #include <iostream>
 
+#include "sdl/displays.h"
 #include "sdl/application.h"
 #include "sdl/window_factory.h"
 #include "vulkan/application.h"
 
 #include "app/renderer.h"
+#include "app/headless.h"
+#include "app/reference.h"
+
+namespace {
+    struct Options {
+        bool Headless = false;
+        bool Cpu = false;
+        HeadlessOptions HeadlessRun;
+        RenderOptions Render;
+    };
+
+    Options ParseOptions(int argc, char** argv) {
+        Options options;
+        for (int i = 1; i < argc; ++i) {
+            const std::string arg = argv[i];
+            if (arg == "--headless") {
+                options.Headless = true;
+            }
+            else if (arg == "--cpu") {
+                options.Cpu = true;
+            }
+            else if (arg == "--size" && i + 1 < argc) {
+                std::sscanf(argv[++i], "%ux%u", &options.HeadlessRun.Width, &options.HeadlessRun.Height);
+            }
+            else if (arg == "--frames" && i + 1 < argc) {
+                options.HeadlessRun.Frames = static_cast<uint32_t>(std::stoul(argv[++i]));
+            }
+            else if (arg == "--images" && i + 1 < argc) {
+                options.HeadlessRun.Images = static_cast<uint32_t>(std::stoul(argv[++i]));
+            }
+            else if (arg == "--frames-in-flight" && i + 1 < argc) {
+                options.Render.FramesInFlight = static_cast<uint32_t>(std::stoul(argv[++i]));
+            }
+            else if (arg == "--present" && i + 1 < argc) {
+                const std::string mode = argv[++i];
+                options.Render.PresentMode = mode == "mailbox" ? vk::PresentModeKHR::eMailbox
+                        : mode == "immediate" ? vk::PresentModeKHR::eImmediate : vk::PresentModeKHR::eFifo;
+            }
+            else if (arg == "--swapchain-images" && i + 1 < argc) {
+                options.Render.SwapChainImages = static_cast<uint32_t>(std::stoul(argv[++i]));
+            }
+            else if (arg == "--pace") {
+                options.Render.FramePacing = true;
+            }
+            else if (arg == "--no-hot-reload") {
+                options.Render.HotReload = false;
+            }
+            else if (arg == "--gpu-profile") {
+                options.Render.GpuProfile = options.HeadlessRun.GpuProfile = true;
+            }
+            else if (arg == "--gpu-profile-csv" && i + 1 < argc) {
+                options.Render.GpuProfile = options.HeadlessRun.GpuProfile = true;
+                options.Render.GpuProfileCsv = options.HeadlessRun.GpuProfileCsv = argv[++i];
+            }
+            else if (arg == "--profiler") {
+                options.Render.PathTracing = options.HeadlessRun.PathTracing = false;
+            }
+        }
+        return options;
+    }
+
+    int RunReference(const HeadlessOptions& options) {
+        FrameTimings timings;
+        ReferenceStatistics stats;
+        if (!Reference_Renderer().RunSecure(options, timings, stats)) {
+            return 1;
+        }
+        timings.Report(std::cout);
+        stats.Report(std::cout);
+        return 0;
+    }
+
+    // Falls back to the CPU renderer when there is no usable Vulkan implementation
+    int RunHeadless(const HeadlessOptions& options) {
+        try {
+            Vulkan::Application::CreateHeadlessInstance({{}, "vxrt", "vxrt", 1, 1});
+        }
+        catch (std::exception& err) {
+            std::cout << "No usable Vulkan instance (" << err.what() << "), using the CPU renderer" << std::endl;
+            return RunReference(options);
+        }
+        FrameTimings timings;
+        if (!Headless_Renderer().RunSecure(options, timings)) {
+            std::cout << "Using the CPU renderer instead" << std::endl;
+            return RunReference(options);
+        }
+        timings.Report(std::cout);
+        return 0;
+    }
+}
+
+int main(int argc, char** argv) {
+    const auto options = ParseOptions(argc, argv);
+    if (options.Cpu) {
+        return RunReference(options.HeadlessRun);
+    }
+    if (options.Headless) {
+        return RunHeadless(options.HeadlessRun);
+    }
 
-int main() {
     static std::thread renderThread;
+    static Vulkan_Renderer renderer(options.Render);
     SDL::Application::Init();
     auto window = SDL::WindowFactory::CreateWindow({
             800, 800, SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED,
             "Vulkan Application",
-            SDL_WINDOW_SHOWN | SDL_WINDOW_VULKAN
+            SDL_WINDOW_SHOWN | SDL_WINDOW_VULKAN | SDL_WINDOW_RESIZABLE
     });
     window->Connect(SDL_WINDOWEVENT_SHOWN, [](SDL::Window& window, const SDL_Event&) {
         Vulkan::Application::CreateInstance({{}, "vxrt", "vxrt", 1, 1});
-        renderThread = std::thread([&]() { Vulkan_Renderer().RenderThreadSecure(window); });
+        if (const auto display = window.GetDisplayIndex(); display >= 0) {
+            renderer.SetRefreshRate(SDL::Displays::Get(display).GetCurrentMode().refresh_rate);
+        }
+        renderThread = std::thread([&]() { renderer.RenderThreadSecure(window); });
+    });
+    for (const auto type : {SDL_KEYDOWN, SDL_KEYUP, SDL_MOUSEMOTION, SDL_MOUSEBUTTONDOWN, SDL_MOUSEBUTTONUP,
+                            SDL_MOUSEWHEEL}) {
+        SDL::Application::Connect(type, [](const SDL_Event& event) { renderer.PushInput(event); });
+    }
+    window->Connect(SDL_WINDOWEVENT_FOCUS_LOST, [](SDL::Window&, const SDL_Event& event) {
+        renderer.PushInput(event);
+    });
+    window->Connect(SDL_WINDOWEVENT_SIZE_CHANGED, [](SDL::Window&, const SDL_Event&) {
+        renderer.NotifyResized();
     });
     window->Connect(SDL_WINDOWEVENT_CLOSE, [](SDL::Window& window, const SDL_Event&) {
         if (renderThread.joinable()) {
+            renderer.Stop();
             renderThread.join();
         }
     });
@@ -0,0 +1,109 @@
+#include "noise.h"
+#include "random.h"
+
+namespace Scene {
+    namespace {
+        using Utils::F32x4;
+        using Utils::U32x4;
+
+        // Rows per task, anything smaller is not worth a round trip through the pool
+        constexpr size_t RowGrain = 16;
+
+        float Max(float a, float b) noexcept { return a > b ? a : b; }
+
+        float Min(float a, float b) noexcept { return a < b ? a : b; }
+
+        void GenerateBase(MipChain& noise, uint32_t seed, Utils::ThreadPool& workers) {
+            const auto size = noise.GetSize(0);
+            const auto data = noise.GetMip(0);
+            const auto seedHash = Hash(seed);
+            workers.ParallelFor(size, RowGrain, [=](size_t begin, size_t end) {
+                for (auto y = static_cast<uint32_t>(begin); y < end; ++y) {
+                    const U32x4 row(Hash(y ^ seedHash));
+                    const auto out = data + size_t(y) * size;
+                    uint32_t x = 0;
+                    for (; x + 4 <= size; x += 4) {
+                        ConstructFloat(Hash(U32x4(x, x + 1, x + 2, x + 3) ^ row)).Store(out + x);
+                    }
+                    for (; x < size; ++x) out[x] = NoiseGenerator::Sample(x, y, seed);
+                }
+            });
+        }
+
+        // Max/Min mip 0: the four corners of every cell, the last column and row wrap around
+        void BoundCells(const MipChain& noise, MipChain& max, MipChain& min, Utils::ThreadPool& workers) {
+            const auto size = noise.GetSize(0);
+            const auto mask = size - 1;
+            const auto data = noise.GetMip(0);
+            const auto maxOut = max.GetMip(0), minOut = min.GetMip(0);
+            workers.ParallelFor(size, RowGrain, [=](size_t begin, size_t end) {
+                for (auto y = static_cast<uint32_t>(begin); y < end; ++y) {
+                    const auto r0 = data + size_t(y) * size, r1 = data + size_t((y + 1) & mask) * size;
+                    const auto offset = size_t(y) * size;
+                    uint32_t x = 0;
+                    for (; x + 5 <= size; x += 4) {
+                        const auto a = F32x4::Load(r0 + x), b = F32x4::Load(r0 + x + 1);
+                        const auto c = F32x4::Load(r1 + x), d = F32x4::Load(r1 + x + 1);
+                        Max(Max(a, b), Max(c, d)).Store(maxOut + offset + x);
+                        Min(Min(a, b), Min(c, d)).Store(minOut + offset + x);
+                    }
+                    for (; x < size; ++x) {
+                        const auto n = (x + 1) & mask;
+                        maxOut[offset + x] = Max(Max(r0[x], r0[n]), Max(r1[x], r1[n]));
+                        minOut[offset + x] = Min(Min(r0[x], r0[n]), Min(r1[x], r1[n]));
+                    }
+                }
+            });
+        }
+
+        template <class Op>
+        void ReduceRow(const float* s0, const float* s1, float* out, uint32_t size, Op op) noexcept {
+            uint32_t x = 0;
+            for (; x + 4 <= size; x += 4) {
+                const auto a = op(F32x4::Load(s0 + 2 * x), F32x4::Load(s1 + 2 * x));
+                const auto b = op(F32x4::Load(s0 + 2 * x + 4), F32x4::Load(s1 + 2 * x + 4));
+                op(EvenLanes(a, b), OddLanes(a, b)).Store(out + x);
+            }
+            for (; x < size; ++x) {
+                out[x] = op(op(s0[2 * x], s0[2 * x + 1]), op(s1[2 * x], s1[2 * x + 1]));
+            }
+        }
+
+        void Reduce(MipChain& chain, uint32_t mip, Utils::ThreadPool& workers, bool max) {
+            const auto size = chain.GetSize(mip);
+            const auto source = chain.GetMip(mip - 1);
+            const auto out = chain.GetMip(mip);
+            workers.ParallelFor(size, RowGrain, [=](size_t begin, size_t end) {
+                for (auto y = begin; y < end; ++y) {
+                    const auto s0 = source + 2 * y * 2 * size, s1 = s0 + 2 * size;
+                    if (max) ReduceRow(s0, s1, out + y * size, size, [](auto a, auto b) { return Max(a, b); });
+                    else ReduceRow(s0, s1, out + y * size, size, [](auto a, auto b) { return Min(a, b); });
+                }
+            });
+        }
+    }
+
+    MipChain::MipChain(uint32_t levels, uint32_t mipCount): _levels(levels) {
+        size_t total = 0;
+        for (uint32_t mip = 0; mip < mipCount; ++mip) {
+            _offsets.push_back(total);
+            total += size_t(GetSize(mip)) * GetSize(mip);
+        }
+        _data.resize(total);
+    }
+
+    NoiseMaps NoiseGenerator::Generate(uint32_t levels, uint32_t seed, Utils::ThreadPool& workers) {
+        NoiseMaps maps{MipChain(levels, 1), MipChain(levels, levels + 1), MipChain(levels, levels + 1)};
+        GenerateBase(maps.Noise, seed, workers);
+        BoundCells(maps.Noise, maps.Max, maps.Min, workers);
+        for (uint32_t mip = 1; mip <= levels; ++mip) {
+            Reduce(maps.Max, mip, workers, true);
+            Reduce(maps.Min, mip, workers, false);
+        }
+        return maps;
+    }
+
+    float NoiseGenerator::Sample(uint32_t x, uint32_t y, uint32_t seed) noexcept {
+        return ConstructFloat(Hash(x ^ Hash(y ^ Hash(seed))));
+    }
+}
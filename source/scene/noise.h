@@ -0,0 +1,53 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include "../util/thread_pool.h"
+
+namespace Scene {
+    // Square single channel mip chain of side 1 << levels. Mips are stored back to back, mip 0 first, each one
+    // tightly packed row major, so the whole chain can be copied into a staging buffer as is
+    class MipChain {
+    public:
+        MipChain() = default;
+
+        MipChain(uint32_t levels, uint32_t mipCount);
+
+        uint32_t GetSize(uint32_t mip) const noexcept { return 1u << (_levels - mip); }
+
+        uint32_t GetMipCount() const noexcept { return static_cast<uint32_t>(_offsets.size()); }
+
+        // In floats from the start of GetData()
+        size_t GetOffset(uint32_t mip) const noexcept { return _offsets[mip]; }
+
+        float* GetMip(uint32_t mip) noexcept { return _data.data() + _offsets[mip]; }
+
+        const float* GetMip(uint32_t mip) const noexcept { return _data.data() + _offsets[mip]; }
+
+        const std::vector<float>& GetData() const noexcept { return _data; }
+    private:
+        uint32_t _levels{};
+        std::vector<size_t> _offsets;
+        std::vector<float> _data;
+    };
+
+    // The base value noise and its conservative bounds. Texel (x, y) of Max/Min mip 0 bounds the bilinearly
+    // filtered noise over the cell between base texels (x, y) and (x + 1, y + 1), wrapping around, which is
+    // exactly what maxNoise2DSubpixel in Final.fsh interpolates. Every further mip bounds the 2x2 texels below
+    struct NoiseMaps {
+        MipChain Noise;
+        MipChain Max;
+        MipChain Min;
+    };
+
+    class NoiseGenerator {
+    public:
+        static constexpr uint32_t DefaultSeed = 0x2333u;
+
+        // Rows are spread over the workers and vectorized four texels at a time
+        static NoiseMaps Generate(uint32_t levels, uint32_t seed, Utils::ThreadPool& workers);
+
+        // Scalar reference for one base texel, the same hash and float construction as rand() in Final.fsh
+        static float Sample(uint32_t x, uint32_t y, uint32_t seed) noexcept;
+    };
+}
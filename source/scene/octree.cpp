@@ -0,0 +1,72 @@
+#include "octree.h"
+
+namespace Scene {
+    namespace {
+        // Nodes per task
+        constexpr size_t NodeGrain = 256;
+
+        struct Pending {
+            uint32_t Index;
+            uint32_t X, Y, Z;
+        };
+    }
+
+    Octree Octree::Build(const Terrain& terrain, uint32_t levels, Utils::ThreadPool& workers) {
+        Octree tree;
+        tree._levels = std::min(levels, MaxLevels);
+        tree._nodes.assign(Root + 1, 0u);
+        std::vector<Pending> frontier;
+        if (const auto root = terrain.GenerateNode(0, 0, 0, 0); root >= 0) {
+            tree._nodes[Root] = MakeLeaf(uint32_t(root));
+            return tree;
+        }
+        if (tree._levels == 0) {
+            tree._nodes[Root] = MakeLeaf(Implicit);
+            return tree;
+        }
+        frontier.push_back({Root, 0, 0, 0});
+
+        for (uint32_t level = 1; level <= tree._levels && !frontier.empty(); ++level) {
+            const auto first = static_cast<uint32_t>(tree._nodes.size());
+            tree._nodes.resize(tree._nodes.size() + frontier.size() * 8);
+            const bool last = level == tree._levels;
+            auto nodes = tree._nodes.data();
+            // The children of the four columns below a node share their height bounds, so each node costs one
+            // four lane evaluation of each bound
+            workers.ParallelFor(frontier.size(), NodeGrain, [&](size_t begin, size_t end) {
+                for (auto i = begin; i < end; ++i) {
+                    const auto& parent = frontier[i];
+                    const auto children = first + static_cast<uint32_t>(i) * 8;
+                    nodes[parent.Index] = MakeBranch(children);
+                    const uint32_t x[4] = {parent.X * 2, parent.X * 2 + 1, parent.X * 2, parent.X * 2 + 1};
+                    const uint32_t z[4] = {parent.Z * 2, parent.Z * 2, parent.Z * 2 + 1, parent.Z * 2 + 1};
+                    uint32_t maxHeight[4], minHeight[4];
+                    terrain.GetMaxHeight(level, x, z, maxHeight);
+                    terrain.GetMinHeight(level, x, z, minHeight);
+                    for (uint32_t c = 0; c < 8; ++c) {
+                        const auto column = (c & 1u) | ((c >> 1u) & 2u); // x + 2z of the child
+                        const auto y = parent.Y * 2 + ((c >> 1u) & 1u);
+                        const auto kind = Terrain::Classify(level, y, maxHeight[column], minHeight[column]);
+                        // Subdivided nodes are patched into branches once their children are placed
+                        nodes[children + c] = kind >= 0 ? MakeLeaf(uint32_t(kind)) : last ? MakeLeaf(Implicit) : 0u;
+                    }
+                }
+            });
+            if (last) break;
+
+            // Gathered sequentially so the layout does not depend on scheduling
+            std::vector<Pending> next;
+            for (size_t i = 0; i < frontier.size(); ++i) {
+                const auto& parent = frontier[i];
+                const auto children = first + static_cast<uint32_t>(i) * 8;
+                for (uint32_t c = 0; c < 8; ++c) {
+                    if (tree._nodes[children + c] != 0u) continue;
+                    next.push_back({children + c, parent.X * 2 + (c & 1u), parent.Y * 2 + ((c >> 1u) & 1u),
+                                    parent.Z * 2 + ((c >> 2u) & 1u)});
+                }
+            }
+            frontier = std::move(next);
+        }
+        return tree;
+    }
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include "terrain.h"
+#include "../util/thread_pool.h"
+
+namespace Scene {
+    // The heightfield octree stored explicitly, in the TreeData layout Final.fsh walks. Every node is one
+    // uint: bit 0 set marks a leaf whose value is in the upper bits, otherwise the upper bits are the offset
+    // of its eight children from Root, ordered x + 2y + 4z. Nodes 0 and below Root are unused. Levels are
+    // stored breadth first, so one level of the walk touches one contiguous range.
+    // Only the top `levels` levels are stored, a node there that still needs subdividing becomes an Implicit
+    // leaf and the shader carries on from it with generateNode. That keeps the buffer at a few MB
+    // where the full 12 levels would need hundreds
+    class Octree {
+    public:
+        static constexpr uint32_t Root = 1u;
+
+        enum Leaf : uint32_t {
+            Empty = 0u,
+            Solid = 1u,
+            Implicit = 2u
+        };
+
+        static constexpr uint32_t DefaultLevels = 8u;
+
+        // One level at a time, the nodes of a level are classified in parallel four columns at a time
+        static Octree Build(const Terrain& terrain, uint32_t levels, Utils::ThreadPool& workers);
+
+        const std::vector<uint32_t>& GetNodes() const noexcept { return _nodes; }
+
+        uint32_t GetLevels() const noexcept { return _levels; }
+
+        static bool IsLeaf(uint32_t node) noexcept { return node & 1u; }
+
+        static uint32_t GetLeaf(uint32_t node) noexcept { return node >> 1u; }
+
+        static uint32_t GetChildren(uint32_t node) noexcept { return (node >> 1u) + Root; }
+    private:
+        static uint32_t MakeLeaf(uint32_t value) noexcept { return (value << 1u) | 1u; }
+
+        static uint32_t MakeBranch(uint32_t children) noexcept { return (children - Root) << 1u; }
+
+        uint32_t _levels{};
+        std::vector<uint32_t> _nodes;
+    };
+}
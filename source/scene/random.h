@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include "../util/simd.h"
+
+namespace Scene {
+    // hash() in Final.fsh
+    constexpr uint32_t Hash(uint32_t x) noexcept {
+        x += x << 10u;
+        x ^= x >> 6u;
+        x += x << 3u;
+        x ^= x >> 11u;
+        x += x << 15u;
+        return x;
+    }
+
+    inline Utils::U32x4 Hash(Utils::U32x4 x) noexcept {
+        x = x + x.ShiftLeft<10>();
+        x = x ^ x.ShiftRight<6>();
+        x = x + x.ShiftLeft<3>();
+        x = x ^ x.ShiftRight<11>();
+        x = x + x.ShiftLeft<15>();
+        return x;
+    }
+
+    // constructFloat() in Final.fsh, maps the mantissa bits onto [0, 1)
+    inline float ConstructFloat(uint32_t m) noexcept {
+        m = (m & 0x007FFFFFu) | 0x3F800000u;
+        float result;
+        std::memcpy(&result, &m, sizeof(result));
+        return result - 1.0f;
+    }
+
+    inline Utils::F32x4 ConstructFloat(Utils::U32x4 m) noexcept {
+        return ((m & Utils::U32x4(0x007FFFFFu)) | Utils::U32x4(0x3F800000u)).AsFloat() - Utils::F32x4(1.0f);
+    }
+
+    inline uint32_t FloatBits(float value) noexcept {
+        uint32_t result;
+        std::memcpy(&result, &value, sizeof(result));
+        return result;
+    }
+
+    // rand(vec3) in Final.fsh, hash(floatBitsToUint(vec4(v, RandomSeed)))
+    inline float Rand(float x, float y, float z, float seed) noexcept {
+        return ConstructFloat(Hash(FloatBits(x) ^ Hash(FloatBits(y) ^ Hash(FloatBits(z) ^ Hash(FloatBits(seed))))));
+    }
+}
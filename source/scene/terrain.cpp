@@ -0,0 +1,171 @@
+#include "terrain.h"
+#include "../util/simd.h"
+
+#include <utility>
+
+namespace Scene {
+    namespace {
+        using Utils::F32x4;
+        using Utils::U32x4;
+
+        constexpr uint32_t Octaves = MaxLevels - NoiseLevels + PartialLevels + 1u;
+        constexpr float NoiseTextureSize = float(1u << NoiseLevels);
+        constexpr uint32_t NoiseMask = (1u << NoiseLevels) - 1u;
+
+        template <bool IsMax>
+        float Extreme(float a, float b) noexcept {
+            if constexpr (IsMax) return a > b ? a : b; else return a < b ? a : b;
+        }
+
+        // maxps / minps pick the same operand as the scalar comparisons above
+        template <bool IsMax>
+        F32x4 Extreme(F32x4 a, F32x4 b) noexcept {
+            if constexpr (IsMax) return Max(a, b); else return Min(a, b);
+        }
+    }
+
+    Terrain::Terrain(NoiseMaps maps): _maps(std::move(maps)) {
+        if (_maps.Noise.GetMipCount() == 0 || _maps.Noise.GetSize(0) != (1u << NoiseLevels) ||
+            _maps.Max.GetMipCount() != NoiseLevels + 1 || _maps.Min.GetMipCount() != NoiseLevels + 1) {
+            throw MapSizeMismatch();
+        }
+    }
+
+    uint32_t Terrain::GetMaxHeight(uint32_t level, uint32_t x, uint32_t z) const noexcept {
+        return Height<true>(level, x, z);
+    }
+
+    uint32_t Terrain::GetMinHeight(uint32_t level, uint32_t x, uint32_t z) const noexcept {
+        return Height<false>(level, x, z);
+    }
+
+    void Terrain::GetMaxHeight(uint32_t level, const uint32_t x[4], const uint32_t z[4], uint32_t out[4]) const noexcept {
+        Height<true>(level, x, z, out);
+    }
+
+    void Terrain::GetMinHeight(uint32_t level, const uint32_t x[4], const uint32_t z[4], uint32_t out[4]) const noexcept {
+        Height<false>(level, x, z, out);
+    }
+
+    int Terrain::GenerateNode(uint32_t level, uint32_t x, uint32_t y, uint32_t z) const noexcept {
+        const auto max = GetMaxHeight(level, x, z);
+        if ((max >> (MaxLevels - level)) < y) return 0;
+        return Classify(level, y, max, GetMinHeight(level, x, z));
+    }
+
+    void Terrain::GenerateNode(uint32_t level, const uint32_t x[4], const uint32_t y[4], const uint32_t z[4],
+            int lanes, int out[4]) const noexcept {
+        const auto shift = MaxLevels - level;
+        uint32_t cx[4], cz[4], height[4];
+        for (int i = 0; i < 4; ++i) {
+            const bool active = lanes & (1 << i);
+            cx[i] = active ? x[i] : 0u;
+            cz[i] = active ? z[i] : 0u;
+        }
+        Height<true>(level, cx, cz, height);
+        int undecided = 0;
+        for (int i = 0; i < 4; ++i) {
+            if (!(lanes & (1 << i))) continue;
+            if ((height[i] >> shift) < y[i]) out[i] = 0;
+            else undecided |= 1 << i;
+        }
+        if (!undecided) return;
+        Height<false>(level, cx, cz, height);
+        for (int i = 0; i < 4; ++i) {
+            if (!(undecided & (1 << i))) continue;
+            if (((height[i] + 1u) >> shift) > y[i]) out[i] = 1;
+            else out[i] = level < MaxLevels ? -1 : 1;
+        }
+    }
+
+    Terrain::Cell Terrain::FetchCell(uint32_t level, uint32_t x, uint32_t z) const noexcept {
+        const auto size = NoiseTextureSize / float(1u << level);
+        const auto px = float(x) * size, pz = float(z) * size;
+        const auto ix = static_cast<uint32_t>(px), iz = static_cast<uint32_t>(pz);
+        const auto base = _maps.Noise.GetMip(0);
+        const auto row0 = size_t(iz & NoiseMask) << NoiseLevels, row1 = size_t((iz + 1u) & NoiseMask) << NoiseLevels;
+        const auto col0 = ix & NoiseMask, col1 = (ix + 1u) & NoiseMask;
+        return Cell{{base[row0 + col0], base[row0 + col1], base[row1 + col0], base[row1 + col1]},
+                    px - float(ix), pz - float(iz)};
+    }
+
+    template <bool Max>
+    float Terrain::Noise2D(uint32_t level, uint32_t x, uint32_t z) const noexcept {
+        if (level <= NoiseLevels) {
+            const auto& chain = Max ? _maps.Max : _maps.Min;
+            return chain.GetMip(NoiseLevels - level)[(size_t(z) << level) + x];
+        }
+        // noise2DSubpixelCorners, corner r is offset by size along x for odd r and along y for r >= 2
+        const auto size = NoiseTextureSize / float(1u << level);
+        const auto cell = FetchCell(level, x, z);
+        float corners[4];
+        for (int r = 0; r < 4; ++r) {
+            const auto fx = (r & 1) ? cell.Fx + size : cell.Fx, fy = (r & 2) ? cell.Fy + size : cell.Fy;
+            corners[r] = (1.0f - fx) * (1.0f - fy) * cell.Texels[0] + fx * (1.0f - fy) * cell.Texels[1] +
+                         (1.0f - fx) * fy * cell.Texels[2] + fx * fy * cell.Texels[3];
+        }
+        return Extreme<Max>(Extreme<Max>(corners[0], corners[1]), Extreme<Max>(corners[2], corners[3]));
+    }
+
+    template <bool Max>
+    uint32_t Terrain::Height(uint32_t level, uint32_t x, uint32_t z) const noexcept {
+        float res = 0.0f, amplitude = float(1u << PartialLevels);
+        level += PartialLevels;
+        for (uint32_t i = 0; i < Octaves; ++i) {
+            res += Noise2D<Max>(level, x, z) * amplitude;
+            amplitude /= 2.0f;
+            if (level > 0u) {
+                level--;
+                x -= x & (1u << level);
+                z -= z & (1u << level);
+            }
+        }
+        return static_cast<uint32_t>(res * HeightScale);
+    }
+
+    // Every lane walks the same levels, so only the texel gathers are per lane. Interpolation, the extreme of
+    // the corners and the octave sum run on all four columns at once, in the same order as the scalar path
+    template <bool Max>
+    void Terrain::Height(uint32_t level, const uint32_t x[4], const uint32_t z[4], uint32_t out[4]) const noexcept {
+        uint32_t px[4] = {x[0], x[1], x[2], x[3]}, pz[4] = {z[0], z[1], z[2], z[3]};
+        F32x4 res(0.0f);
+        float amplitude = float(1u << PartialLevels);
+        level += PartialLevels;
+        for (uint32_t i = 0; i < Octaves; ++i) {
+            F32x4 curr;
+            if (level <= NoiseLevels) {
+                const auto mip = (Max ? _maps.Max : _maps.Min).GetMip(NoiseLevels - level);
+                curr = F32x4(mip[(size_t(pz[0]) << level) + px[0]], mip[(size_t(pz[1]) << level) + px[1]],
+                        mip[(size_t(pz[2]) << level) + px[2]], mip[(size_t(pz[3]) << level) + px[3]]);
+            }
+            else {
+                const Cell cells[4] = {FetchCell(level, px[0], pz[0]), FetchCell(level, px[1], pz[1]),
+                                       FetchCell(level, px[2], pz[2]), FetchCell(level, px[3], pz[3])};
+                F32x4 texels[4];
+                for (int t = 0; t < 4; ++t) {
+                    texels[t] = F32x4(cells[0].Texels[t], cells[1].Texels[t], cells[2].Texels[t], cells[3].Texels[t]);
+                }
+                const F32x4 size(NoiseTextureSize / float(1u << level)), one(1.0f);
+                const F32x4 fx0(cells[0].Fx, cells[1].Fx, cells[2].Fx, cells[3].Fx);
+                const F32x4 fy0(cells[0].Fy, cells[1].Fy, cells[2].Fy, cells[3].Fy);
+                F32x4 corners[4];
+                for (int r = 0; r < 4; ++r) {
+                    const auto fx = (r & 1) ? fx0 + size : fx0, fy = (r & 2) ? fy0 + size : fy0;
+                    corners[r] = (one - fx) * (one - fy) * texels[0] + fx * (one - fy) * texels[1] +
+                                 (one - fx) * fy * texels[2] + fx * fy * texels[3];
+                }
+                curr = Extreme<Max>(Extreme<Max>(corners[0], corners[1]), Extreme<Max>(corners[2], corners[3]));
+            }
+            res = res + curr * F32x4(amplitude);
+            amplitude /= 2.0f;
+            if (level > 0u) {
+                level--;
+                for (int l = 0; l < 4; ++l) {
+                    px[l] -= px[l] & (1u << level);
+                    pz[l] -= pz[l] & (1u << level);
+                }
+            }
+        }
+        U32x4::Truncate(res * F32x4(HeightScale)).Store(out);
+    }
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint>
+#include "noise.h"
+#include "../util/exceptions.h"
+
+namespace Scene {
+    // Constants of Final.fsh
+    constexpr uint32_t MaxLevels = 12u;
+    constexpr uint32_t NoiseLevels = 8u;
+    constexpr uint32_t PartialLevels = 7u;
+    constexpr uint32_t RootSize = 1u << MaxLevels;
+    constexpr float HeightScale = float(1u << MaxLevels) / 256.0f;
+
+    // The implicit heightfield octree of Final.fsh evaluated on the CPU: getMaxHeight, getMinHeight and
+    // generateNode with the textures replaced by the generated NoiseMaps. The four lane overloads evaluate four
+    // columns at the same level with SIMD and give the same bits as four scalar calls
+    class Terrain {
+    public:
+        VXRT_EXCEPTION(MapSizeMismatch, "Noise Maps Do Not Match NoiseLevels")
+
+        explicit Terrain(NoiseMaps maps);
+
+        uint32_t GetMaxHeight(uint32_t level, uint32_t x, uint32_t z) const noexcept;
+
+        uint32_t GetMinHeight(uint32_t level, uint32_t x, uint32_t z) const noexcept;
+
+        // 0 empty, 1 opaque leaf, -1 subdivide further
+        int GenerateNode(uint32_t level, uint32_t x, uint32_t y, uint32_t z) const noexcept;
+
+        void GetMaxHeight(uint32_t level, const uint32_t x[4], const uint32_t z[4], uint32_t out[4]) const noexcept;
+
+        void GetMinHeight(uint32_t level, const uint32_t x[4], const uint32_t z[4], uint32_t out[4]) const noexcept;
+
+        // generateNode for a node whose column bounds are already known
+        static int Classify(uint32_t level, uint32_t y, uint32_t maxHeight, uint32_t minHeight) noexcept {
+            const auto shift = MaxLevels - level;
+            if ((maxHeight >> shift) < y) return 0;
+            if (((minHeight + 1u) >> shift) > y) return 1; // Solid all the way through
+            return level < MaxLevels ? -1 : 1;
+        }
+
+        // Only the lanes set in `lanes` are evaluated and written, the others may hold any coordinates
+        void GenerateNode(uint32_t level, const uint32_t x[4], const uint32_t y[4], const uint32_t z[4],
+                int lanes, int out[4]) const noexcept;
+
+        const NoiseMaps& GetMaps() const noexcept { return _maps; }
+    private:
+        // The four texels and the fractional position maxNoise2DSubpixel interpolates between
+        struct Cell {
+            float Texels[4];
+            float Fx, Fy;
+        };
+
+        Cell FetchCell(uint32_t level, uint32_t x, uint32_t z) const noexcept;
+
+        template <bool Max>
+        float Noise2D(uint32_t level, uint32_t x, uint32_t z) const noexcept;
+
+        template <bool Max>
+        uint32_t Height(uint32_t level, uint32_t x, uint32_t z) const noexcept;
+
+        template <bool Max>
+        void Height(uint32_t level, const uint32_t x[4], const uint32_t z[4], uint32_t out[4]) const noexcept;
+
+        NoiseMaps _maps;
+    };
+}
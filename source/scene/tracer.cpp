@@ -0,0 +1,521 @@
+#include "tracer.h"
+#include "random.h"
+
+#include <cmath>
+#include <atomic>
+#include <algorithm>
+
+namespace Scene {
+    namespace {
+        using Utils::F32x4;
+        using Utils::U32x4;
+
+        constexpr float Pi = 3.14159265f;
+        constexpr float Gamma = 2.2f;
+        constexpr float SunlightAngle = 0.996f;
+        constexpr float ProbabilityToSun = 0.0f;
+        constexpr int MaxTracedRays = 4;
+        constexpr float TerminationProbability = 0.2f;
+
+        Vec3 operator+(Vec3 a, Vec3 b) noexcept { return {a.X + b.X, a.Y + b.Y, a.Z + b.Z}; }
+
+        Vec3 operator-(Vec3 a, Vec3 b) noexcept { return {a.X - b.X, a.Y - b.Y, a.Z - b.Z}; }
+
+        Vec3 operator-(Vec3 a) noexcept { return {-a.X, -a.Y, -a.Z}; }
+
+        Vec3 operator*(Vec3 a, Vec3 b) noexcept { return {a.X * b.X, a.Y * b.Y, a.Z * b.Z}; }
+
+        Vec3 operator*(Vec3 a, float s) noexcept { return {a.X * s, a.Y * s, a.Z * s}; }
+
+        Vec3 operator*(float s, Vec3 a) noexcept { return {s * a.X, s * a.Y, s * a.Z}; }
+
+        Vec3 operator/(Vec3 a, float s) noexcept { return {a.X / s, a.Y / s, a.Z / s}; }
+
+        float Dot(Vec3 a, Vec3 b) noexcept { return a.X * b.X + a.Y * b.Y + a.Z * b.Z; }
+
+        Vec3 Cross(Vec3 a, Vec3 b) noexcept {
+            return {a.Y * b.Z - b.Y * a.Z, a.Z * b.X - b.Z * a.X, a.X * b.Y - b.X * a.Y};
+        }
+
+        Vec3 Normalize(Vec3 v) noexcept { return v / std::sqrt(Dot(v, v)); }
+
+        float Rand(Vec3 v, float seed) noexcept { return Scene::Rand(v.X, v.Y, v.Z, seed); }
+
+        bool Inside(Vec3 a, Vec3 boxA, Vec3 boxB) noexcept {
+            return a.X >= boxA.X && a.X < boxB.X &&
+                   a.Y >= boxA.Y && a.Y < boxB.Y &&
+                   a.Z >= boxA.Z && a.Z < boxB.Z;
+        }
+
+        bool InsideRoot(Vec3 a) noexcept { return Inside(a, {0.0f, 0.0f, 0.0f}, {float(RootSize), float(RootSize), float(RootSize)}); }
+
+        constexpr int BackFace[7] = {0, 2, 1, 4, 3, 6, 5};
+
+        constexpr Vec3 Normal[7] = {
+                { 0.0f, 0.0f, 0.0f},
+                {+1.0f, 0.0f, 0.0f},
+                {-1.0f, 0.0f, 0.0f},
+                { 0.0f,+1.0f, 0.0f},
+                { 0.0f,-1.0f, 0.0f},
+                { 0.0f, 0.0f,+1.0f},
+                { 0.0f, 0.0f,-1.0f}
+        };
+
+        constexpr Vec3 Dither[3] = {
+                {12.1322f, 23.1313423f, 34.959f},
+                {23.183f, 11.232f, 54.9923f},
+                {345.99253f, 2345.2323f, 78.1233f}
+        };
+
+        const Vec3 SunlightDirection = Normalize({0.6f, -1.0f, 0.3f});
+
+        Vec3 Decode(float r, float g, float b) noexcept {
+            return {std::pow(r / 255.0f, Gamma), std::pow(g / 255.0f, Gamma), std::pow(b / 255.0f, Gamma)};
+        }
+
+        const Vec3 Palette[7] = {
+                {0.0f, 0.0f, 0.0f},
+                Decode(147.5f, 166.4f, 77.0f),
+                Decode(147.5f, 166.4f, 77.0f),
+                Decode(151.0f, 228.0f, 90.0f),
+                Decode(144.0f, 105.0f, 64.0f),
+                Decode(147.5f, 166.4f, 77.0f),
+                Decode(147.5f, 166.4f, 77.0f)
+        };
+
+        constexpr Vec3 SkyColor {1.0f, 1.0f, 1.0f};
+
+        // GLSL matrix products, column major and summed in column order
+        Mat4 Multiply(const Mat4& a, const Mat4& b) noexcept {
+            Mat4 result {};
+            for (int c = 0; c < 4; ++c) {
+                for (int r = 0; r < 4; ++r) {
+                    result[c * 4 + r] = a[r] * b[c * 4] + a[4 + r] * b[c * 4 + 1] + a[8 + r] * b[c * 4 + 2] +
+                                        a[12 + r] * b[c * 4 + 3];
+                }
+            }
+            return result;
+        }
+
+        // (m * vec4(x, y, z, w)).xyz / .w, which is divide() in Final.fsh
+        Vec3 TransformDivide(const Mat4& m, float x, float y, float z, float w) noexcept {
+            float v[4];
+            for (int r = 0; r < 4; ++r) v[r] = m[r] * x + m[4 + r] * y + m[8 + r] * z + m[12 + r] * w;
+            return {v[0] / v[3], v[1] / v[3], v[2] / v[3]};
+        }
+
+        F32x4 LaneMask(int lanes) noexcept {
+            return U32x4(lanes & 1 ? ~0u : 0u, lanes & 2 ? ~0u : 0u, lanes & 4 ? ~0u : 0u, lanes & 8 ? ~0u : 0u).AsFloat();
+        }
+
+        int PopCount(int lanes) noexcept { return (lanes & 1) + (lanes >> 1 & 1) + (lanes >> 2 & 1) + (lanes >> 3 & 1); }
+
+        template <class Func>
+        void ForLanes(int lanes, Func func) {
+            for (int l = 0; l < 4; ++l) if (lanes & (1 << l)) func(l);
+        }
+
+        uint32_t HighestBit(uint32_t v) noexcept {
+            uint32_t bit = 0;
+            while (v >>= 1u) ++bit;
+            return bit;
+        }
+
+        // The first level whose node may differ from the one the cursor was left at, findMSB in getNodeFrom
+        uint32_t ResumeLevel(uint32_t level, uint32_t diff) noexcept {
+            return diff ? std::min(level, MaxLevels - HighestBit(diff)) : level;
+        }
+    }
+
+    // Four rays in structure of arrays form. Pos / Face is the running Intersection, Probe the point handed to
+    // getNodeAt and A / B the box it returned
+    struct Tracer::Packet {
+        alignas(16) float PosX[4], PosY[4], PosZ[4];
+        alignas(16) float DirX[4], DirY[4], DirZ[4];
+        alignas(16) float ProbeX[4], ProbeY[4], ProbeZ[4];
+        alignas(16) float AX[4], AY[4], AZ[4], BX[4], BY[4], BZ[4];
+        int Face[4];
+        uint32_t Ptr[4];
+        int Iterations[4];
+        Cursor Cursors[4];
+
+        Vec3 GetPos(int l) const noexcept { return {PosX[l], PosY[l], PosZ[l]}; }
+
+        void SetPos(int l, Vec3 v) noexcept { PosX[l] = v.X, PosY[l] = v.Y, PosZ[l] = v.Z; }
+
+        Vec3 GetDir(int l) const noexcept { return {DirX[l], DirY[l], DirZ[l]}; }
+
+        void SetDir(int l, Vec3 v) noexcept { DirX[l] = v.X, DirY[l] = v.Y, DirZ[l] = v.Z; }
+    };
+
+    TraceStatistics Tracer::Render(const TraceParameters& parameters, std::vector<float>& rgba,
+            Utils::ThreadPool& workers) const {
+        rgba.resize(size_t(parameters.Width) * parameters.Height * 4);
+        const auto tilesX = (parameters.Width + TileSize - 1) / TileSize;
+        const auto tilesY = (parameters.Height + TileSize - 1) / TileSize;
+        std::atomic<uint64_t> rays{0}, steps{0}, nodes{0};
+        workers.ParallelFor(size_t(tilesX) * tilesY, 1, [&](size_t begin, size_t end) {
+            TraceStatistics stats;
+            for (auto tile = begin; tile < end; ++tile) {
+                const auto x0 = static_cast<uint32_t>(tile % tilesX) * TileSize;
+                const auto y0 = static_cast<uint32_t>(tile / tilesX) * TileSize;
+                for (auto y = y0; y < std::min(y0 + TileSize, parameters.Height); y += 2) {
+                    for (auto x = x0; x < std::min(x0 + TileSize, parameters.Width); x += 2) {
+                        TraceQuad(parameters, x, y, rgba.data(), stats);
+                    }
+                }
+            }
+            rays += stats.Rays;
+            steps += stats.Steps;
+            nodes += stats.Nodes;
+        });
+        return {rays.load(), steps.load(), nodes.load()};
+    }
+
+    // main() of Final.fsh, one sample
+    Vec3 Tracer::TracePixel(const TraceParameters& parameters, uint32_t x, uint32_t y, TraceStatistics& stats) const {
+        Vec3 pos, dir;
+        PrimaryRay(parameters, x, y, pos, dir);
+        if (!parameters.PathTracing) {
+            const auto steps = float(MarchProfiler(pos, dir, parameters.Traversal, stats)) / 256.0f;
+            return {steps, steps, steps};
+        }
+        auto path = StartPath(pos, dir);
+        for (int i = 0; i < MaxTracedRays; ++i) {
+            path.P = RayMarch(path.P, path.Dir, parameters.Traversal, stats);
+            if (Bounce(path, parameters.RandomSeed)) return path.Color;
+        }
+        return path.Res * SkyColor;
+    }
+
+    void Tracer::PrimaryRay(const TraceParameters& parameters, uint32_t x, uint32_t y, Vec3& pos, Vec3& dir) const {
+        const auto width = float(parameters.Width), height = float(parameters.Height);
+        // FragCoords at the pixel center, the vertex shader maps the quad straight onto clip space
+        const auto fx = (float(x) + 0.5f) / width * 2.0f - 1.0f, fy = (float(y) + 0.5f) / height * 2.0f - 1.0f;
+        const auto randx = Rand({fx, fy, 1.0f}, parameters.RandomSeed) * 2.0f - 1.0f;
+        const auto randy = Rand({fx, fy, -1.0f}, parameters.RandomSeed) * 2.0f - 1.0f;
+        const auto dx = fx + randx / width, dy = fy + randy / height; // Anti-aliasing
+
+        const auto inverse = Multiply(parameters.ModelViewInverse, parameters.ProjectionInverse);
+        dir = Normalize(TransformDivide(inverse, dx, dy, 1.0f, 1.0f));
+        const auto centerDir = Normalize(TransformDivide(inverse, 0.0f, 0.0f, 1.0f, 1.0f));
+
+        pos = parameters.CameraPosition * 160.0f + Vec3{23.3f, float(RootSize) / 8.0f + 23.3f, 23.3f};
+        // apertureDither with a zero aperture leaves pos alone but still renormalizes dir through the focus
+        const auto focus = pos + dir * (float(RootSize) / 6.0f / Dot(dir, centerDir));
+        dir = Normalize(focus - pos);
+    }
+
+    // getNodeFrom, a cursor at level 0 makes it getNodeAt. Boxes are cut from the integer position instead of
+    // halved level by level, which gives the same bits
+    Tracer::Node Tracer::GetNodeAt(Vec3 pos, Cursor& cursor, TraceStatistics& stats) const noexcept {
+        AABB box{{0.0f, 0.0f, 0.0f}, {float(RootSize), float(RootSize), float(RootSize)}};
+        if (!InsideRoot(pos)) return {0u, box}; // Outside
+        const auto px = static_cast<uint32_t>(pos.X), py = static_cast<uint32_t>(pos.Y), pz = static_cast<uint32_t>(pos.Z);
+        auto level = ResumeLevel(cursor.Level, (px ^ cursor.X) | (py ^ cursor.Y) | (pz ^ cursor.Z));
+        int curr;
+        for (;; level++) {
+            ++stats.Nodes;
+            const auto shift = MaxLevels - level;
+            curr = _terrain.GenerateNode(level, px >> shift, py >> shift, pz >> shift);
+            if (curr >= 0) break;
+        }
+        cursor = {level, px, py, pz};
+        const auto shift = MaxLevels - level;
+        const auto size = float(1u << shift);
+        box.A = {float(px >> shift << shift), float(py >> shift << shift), float(pz >> shift << shift)};
+        box.B = box.A + Vec3{size, size, size};
+        return {uint32_t(curr + 1), box};
+    }
+
+    namespace {
+        struct Hit {
+            Vec3 Pos;
+            int Face;
+        };
+
+        Hit InnerIntersect(Vec3 org, Vec3 dir, Vec3 a, Vec3 b) noexcept {
+            const float scale[7] = {
+                    0.0f,
+                    (a.X - org.X) / dir.X, // x- (Reversed from normal)
+                    (b.X - org.X) / dir.X, // x+
+                    (a.Y - org.Y) / dir.Y, // y-
+                    (b.Y - org.Y) / dir.Y, // y+
+                    (a.Z - org.Z) / dir.Z, // z-
+                    (b.Z - org.Z) / dir.Z  // z+
+            };
+            int face = 0;
+            for (int i = 1; i <= 6; i++) {
+                if (Dot(dir, Normal[i]) < 0.0f && scale[i] > 0.0f) {
+                    if (face == 0 || scale[i] < scale[face]) face = i;
+                }
+            }
+            return {org + dir * scale[face], face};
+        }
+
+        Hit OuterIntersect(Vec3 org, Vec3 dir, Vec3 a, Vec3 b) noexcept {
+            const float scale[7] = {
+                    0.0f,
+                    (b.X - org.X) / dir.X, // x+
+                    (a.X - org.X) / dir.X, // x-
+                    (b.Y - org.Y) / dir.Y, // y+
+                    (a.Y - org.Y) / dir.Y, // y-
+                    (b.Z - org.Z) / dir.Z, // z+
+                    (a.Z - org.Z) / dir.Z  // z-
+            };
+            int face = 0;
+            for (int i = 1; i <= 6; i++) {
+                if (scale[i] > 0.0f) {
+                    const auto curr = org + dir * scale[i];
+                    if ((face == 0 || scale[i] < scale[face]) && Inside(curr - 0.1f * Normal[i], a, b)) face = i;
+                }
+            }
+            return {org + dir * scale[face], face};
+        }
+
+        Hit OuterIntersectRoot(Vec3 org, Vec3 dir) noexcept {
+            return OuterIntersect(org, dir, {0.0f, 0.0f, 0.0f}, {float(RootSize), float(RootSize), float(RootSize)});
+        }
+    }
+
+    Tracer::Intersection Tracer::RayMarch(Intersection p, Vec3 dir, Traversal traversal,
+            TraceStatistics& stats) const noexcept {
+        ++stats.Rays;
+        dir = Normalize(dir);
+        if (!InsideRoot(p.Pos)) {
+            const auto hit = OuterIntersectRoot(p.Pos, dir);
+            p = {hit.Pos, hit.Face};
+        }
+        Cursor cursor;
+        for (uint32_t i = 0; i < RootSize; i++) {
+            ++stats.Steps;
+            if (traversal == Traversal::Restart) cursor = {};
+            const auto node = GetNodeAt(p.Pos - 0.1f * Normal[p.Face], cursor, stats);
+            if (node.Ptr == 0u) break; // Out of range
+            if (node.Ptr - 1u != 0u) return p; // Opaque block
+            const auto hit = InnerIntersect(p.Pos, dir, node.Box.A, node.Box.B);
+            p = {hit.Pos, hit.Face};
+        }
+        return {p.Pos, 0};
+    }
+
+    int Tracer::MarchProfiler(Vec3 org, Vec3 dir, Traversal traversal, TraceStatistics& stats) const noexcept {
+        ++stats.Rays;
+        dir = Normalize(dir);
+        Intersection p{org, 0};
+        if (!InsideRoot(p.Pos)) {
+            const auto hit = OuterIntersectRoot(p.Pos, dir);
+            p = {hit.Pos, hit.Face};
+        }
+        Cursor cursor;
+        for (uint32_t i = 0; i < RootSize; i++) {
+            ++stats.Steps;
+            if (traversal == Traversal::Restart) cursor = {};
+            const auto node = GetNodeAt(p.Pos - 0.1f * Normal[p.Face], cursor, stats);
+            if (node.Ptr == 0u || node.Ptr - 1u != 0u) return int(i);
+            const auto hit = InnerIntersect(p.Pos, dir, node.Box.A, node.Box.B);
+            p = {hit.Pos, hit.Face};
+        }
+        return int(RootSize);
+    }
+
+    Tracer::Path Tracer::StartPath(Vec3 org, Vec3 dir) noexcept {
+        return {{1.0f, 1.0f, 1.0f}, org, Normalize(dir), {org, 0}, {}};
+    }
+
+    // The body of the rayTrace loop (LAMBERTIAN_DIFFUSE) after rayMarch returned
+    bool Tracer::Bounce(Path& path, float seed) noexcept {
+        auto& p = path.P;
+        if (p.Face == 0) {
+            path.Color = path.Res * SkyColor;
+            return true;
+        }
+        if (Rand(p.Pos, seed) <= TerminationProbability) {
+            path.Color = {0.0f, 0.0f, 0.0f};
+            return true;
+        }
+        path.Res = path.Res / (1.0f - TerminationProbability);
+        path.Res = path.Res * Palette[p.Face];
+        path.Org = p.Pos;
+        const auto org = path.Org;
+
+        const auto pr = Dot(Normal[p.Face], -SunlightDirection) > 0.1f ? ProbabilityToSun : 0.0f;
+        const bool towardsSun = Rand(org + Dither[0], seed) <= pr;
+        auto pdf = 1.0f - pr;
+
+        auto alpha = std::acos(Rand(org + Dither[1], seed) * 2.0f - 1.0f);
+        if (towardsSun) alpha = std::acos(1.0f - Rand(org + Dither[1], seed) * (1.0f - SunlightAngle));
+        const auto beta = Rand(org + Dither[2], seed) * 2.0f * Pi;
+        auto dir = Vec3{std::cos(alpha), std::sin(alpha) * std::cos(beta), std::sin(alpha) * std::sin(beta)};
+        if (towardsSun) {
+            const auto tangent = Normalize(Cross(-SunlightDirection, {1.0f, 0.0f, 0.0f}));
+            const auto bitangent = Cross(-SunlightDirection, tangent);
+            dir = -SunlightDirection * dir.X + tangent * dir.Y + bitangent * dir.Z;
+            pdf += pr / (1.0f - SunlightAngle);
+        }
+        path.Res = path.Res / pdf;
+
+        auto proj = Dot(Normal[p.Face], dir);
+        if (proj < 0.0f) {
+            dir = dir - 2.0f * proj * Normal[p.Face];
+            proj = -proj;
+        }
+        path.Res = path.Res * proj;
+        path.Dir = dir;
+        p.Face = BackFace[p.Face];
+        return false;
+    }
+
+    // getNodeFrom for four probes. Lanes join the descent at the level their own cursor resumes from, so all
+    // lanes evaluating a level do it together in Terrain::GenerateNode
+    void Tracer::GetNodeAt(Packet& packet, int lanes, TraceStatistics& stats) const noexcept {
+        int pending = 0;
+        uint32_t ix[4]{}, iy[4]{}, iz[4]{}, begin[4]{};
+        auto level = MaxLevels;
+        ForLanes(lanes, [&](int l) {
+            const Vec3 probe{packet.ProbeX[l], packet.ProbeY[l], packet.ProbeZ[l]};
+            if (!InsideRoot(probe)) {
+                packet.Ptr[l] = 0u; // Outside
+                return;
+            }
+            pending |= 1 << l;
+            ix[l] = static_cast<uint32_t>(probe.X), iy[l] = static_cast<uint32_t>(probe.Y), iz[l] = static_cast<uint32_t>(probe.Z);
+            const auto& cursor = packet.Cursors[l];
+            begin[l] = ResumeLevel(cursor.Level, (ix[l] ^ cursor.X) | (iy[l] ^ cursor.Y) | (iz[l] ^ cursor.Z));
+            level = std::min(level, begin[l]);
+        });
+        for (; pending; level++) {
+            int active = 0;
+            ForLanes(pending, [&](int l) { if (begin[l] <= level) active |= 1 << l; });
+            const auto shift = MaxLevels - level;
+            const uint32_t nx[4] = {ix[0] >> shift, ix[1] >> shift, ix[2] >> shift, ix[3] >> shift};
+            const uint32_t ny[4] = {iy[0] >> shift, iy[1] >> shift, iy[2] >> shift, iy[3] >> shift};
+            const uint32_t nz[4] = {iz[0] >> shift, iz[1] >> shift, iz[2] >> shift, iz[3] >> shift};
+            int curr[4];
+            _terrain.GenerateNode(level, nx, ny, nz, active, curr);
+            stats.Nodes += PopCount(active);
+            const auto size = float(1u << shift);
+            ForLanes(active, [&](int l) {
+                if (curr[l] < 0) return;
+                packet.Ptr[l] = uint32_t(curr[l] + 1);
+                packet.Cursors[l] = {level, ix[l], iy[l], iz[l]};
+                packet.AX[l] = float(nx[l] << shift), packet.BX[l] = packet.AX[l] + size;
+                packet.AY[l] = float(ny[l] << shift), packet.BY[l] = packet.AY[l] + size;
+                packet.AZ[l] = float(nz[l] << shift), packet.BZ[l] = packet.AZ[l] + size;
+                pending &= ~(1 << l);
+            });
+        }
+    }
+
+    // rayMarch for four rays starting from Pos / Face along Dir. On return Pos / Face hold each lane's
+    // Intersection and Iterations the loop index it left at, which is marchProfiler's result
+    void Tracer::RayMarch(Packet& packet, int lanes, Traversal traversal, TraceStatistics& stats) const noexcept {
+        ForLanes(lanes, [&](int l) {
+            ++stats.Rays;
+            const auto dir = Normalize(packet.GetDir(l));
+            packet.SetDir(l, dir);
+            if (!InsideRoot(packet.GetPos(l))) {
+                const auto hit = OuterIntersectRoot(packet.GetPos(l), dir);
+                packet.SetPos(l, hit.Pos);
+                packet.Face[l] = hit.Face;
+            }
+            packet.Iterations[l] = int(RootSize);
+            packet.Cursors[l] = {};
+        });
+        const auto dx = F32x4::Load(packet.DirX), dy = F32x4::Load(packet.DirY), dz = F32x4::Load(packet.DirZ);
+        const F32x4 zero(0.0f);
+        int marching = lanes;
+        for (uint32_t i = 0; i < RootSize && marching; i++) {
+            stats.Steps += PopCount(marching);
+            ForLanes(marching, [&](int l) {
+                const auto probe = packet.GetPos(l) - 0.1f * Normal[packet.Face[l]];
+                packet.ProbeX[l] = probe.X, packet.ProbeY[l] = probe.Y, packet.ProbeZ[l] = probe.Z;
+                if (traversal == Traversal::Restart) packet.Cursors[l] = {};
+            });
+            GetNodeAt(packet, marching, stats);
+            int next = 0;
+            ForLanes(marching, [&](int l) {
+                if (packet.Ptr[l] == 0u) packet.Face[l] = 0; // Out of range
+                if (packet.Ptr[l] == 0u || packet.Ptr[l] - 1u != 0u) packet.Iterations[l] = int(i);
+                else next |= 1 << l;
+            });
+            marching = next;
+            if (!marching) break;
+
+            // innerIntersect on all lanes at once, a candidate face needs the ray to head towards it
+            const auto ox = F32x4::Load(packet.PosX), oy = F32x4::Load(packet.PosY), oz = F32x4::Load(packet.PosZ);
+            const F32x4 scale[7] = {
+                    zero,
+                    (F32x4::Load(packet.AX) - ox) / dx, (F32x4::Load(packet.BX) - ox) / dx,
+                    (F32x4::Load(packet.AY) - oy) / dy, (F32x4::Load(packet.BY) - oy) / dy,
+                    (F32x4::Load(packet.AZ) - oz) / dz, (F32x4::Load(packet.BZ) - oz) / dz
+            };
+            const F32x4 towards[7] = {zero, dx < zero, zero < dx, dy < zero, zero < dy, dz < zero, zero < dz};
+            F32x4 face = zero, best = zero;
+            for (int f = 1; f <= 6; f++) {
+                const auto take = towards[f] & (scale[f] > zero) & ((face == zero) | (scale[f] < best));
+                face = Select(take, F32x4(float(f)), face);
+                best = Select(take, scale[f], best);
+            }
+            const auto mask = LaneMask(marching);
+            Select(mask, ox + dx * best, ox).Store(packet.PosX);
+            Select(mask, oy + dy * best, oy).Store(packet.PosY);
+            Select(mask, oz + dz * best, oz).Store(packet.PosZ);
+            alignas(16) float faces[4];
+            face.Store(faces);
+            ForLanes(marching, [&](int l) { packet.Face[l] = int(faces[l]); });
+        }
+        ForLanes(marching, [&](int l) { packet.Face[l] = 0; });
+    }
+
+    void Tracer::TraceQuad(const TraceParameters& parameters, uint32_t x, uint32_t y, float* rgba,
+            TraceStatistics& stats) const {
+        int lanes = 0;
+        Vec3 colors[4]{};
+        Path paths[4];
+        Packet packet{};
+        for (int l = 0; l < 4; ++l) {
+            const auto px = x + (l & 1), py = y + (l >> 1);
+            if (px >= parameters.Width || py >= parameters.Height) continue;
+            lanes |= 1 << l;
+            Vec3 pos, dir;
+            PrimaryRay(parameters, px, py, pos, dir);
+            paths[l] = StartPath(pos, dir);
+            packet.SetPos(l, pos);
+            packet.SetDir(l, dir);
+            packet.Face[l] = 0;
+        }
+
+        if (!parameters.PathTracing) {
+            RayMarch(packet, lanes, parameters.Traversal, stats);
+            ForLanes(lanes, [&](int l) {
+                const auto steps = float(packet.Iterations[l]) / 256.0f;
+                colors[l] = {steps, steps, steps};
+            });
+        }
+        else {
+            int alive = lanes;
+            for (int i = 0; i < MaxTracedRays && alive; ++i) {
+                ForLanes(alive, [&](int l) {
+                    packet.SetPos(l, paths[l].P.Pos);
+                    packet.Face[l] = paths[l].P.Face;
+                    packet.SetDir(l, paths[l].Dir);
+                });
+                RayMarch(packet, alive, parameters.Traversal, stats);
+                ForLanes(alive, [&](int l) {
+                    paths[l].P = {packet.GetPos(l), packet.Face[l]};
+                    if (Bounce(paths[l], parameters.RandomSeed)) {
+                        colors[l] = paths[l].Color;
+                        alive &= ~(1 << l);
+                    }
+                });
+            }
+            ForLanes(alive, [&](int l) { colors[l] = paths[l].Res * SkyColor; });
+        }
+
+        ForLanes(lanes, [&](int l) {
+            const auto out = rgba + (size_t(y + (l >> 1)) * parameters.Width + x + (l & 1)) * 4;
+            out[0] = colors[l].X, out[1] = colors[l].Y, out[2] = colors[l].Z, out[3] = 1.0f;
+        });
+    }
+}
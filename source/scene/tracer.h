@@ -0,0 +1,117 @@
+#pragma once
+
+#include <array>
+#include <vector>
+#include <cstdint>
+#include "terrain.h"
+#include "../util/thread_pool.h"
+
+namespace Scene {
+    struct Vec3 {
+        float X, Y, Z;
+    };
+
+    // Column major, the same memory layout as a GLSL mat4
+    using Mat4 = std::array<float, 16>;
+
+    // How each step of a march finds its node: from the root every time (getNodeAt), or resuming below the
+    // deepest level it shares with the previous one (getNodeFrom)
+    enum class Traversal {
+        Restart,
+        Resume
+    };
+
+    // The subset of FrameUniforms Final.fsh reads
+    struct TraceParameters {
+        Mat4 ProjectionInverse {1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1};
+        Mat4 ModelViewInverse {1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1};
+        Vec3 CameraPosition {};
+        float RandomSeed = 0.0f;
+        bool PathTracing = true;
+        uint32_t Width = 0, Height = 0;
+        Scene::Traversal Traversal = Traversal::Resume;
+    };
+
+    // A ray is one rayMarch / marchProfiler call, a step is one node lookup inside it and Nodes counts the
+    // generateNode evaluations those lookups took
+    struct TraceStatistics {
+        uint64_t Rays = 0;
+        uint64_t Steps = 0;
+        uint64_t Nodes = 0;
+
+        TraceStatistics& operator+=(const TraceStatistics& other) noexcept {
+            Rays += other.Rays;
+            Steps += other.Steps;
+            Nodes += other.Nodes;
+            return *this;
+        }
+    };
+
+    // CPU port of the ray marcher in Final.fsh, one sample per pixel. Render traces 2x2 pixel quads as four lane
+    // packets and spreads tiles over the pool; TracePixel is the plain scalar transcription both are checked
+    // against. The two produce identical bits, and follow the shader operation for operation so a shader
+    // change can be validated against them
+    class Tracer {
+    public:
+        static constexpr uint32_t TileSize = 16;
+
+        explicit Tracer(const Terrain& terrain) noexcept: _terrain(terrain) { }
+
+        // Fills `rgba` with Width * Height linear RGBA pixels, row major with row 0 at the top like the GPU target
+        TraceStatistics Render(const TraceParameters& parameters, std::vector<float>& rgba,
+                Utils::ThreadPool& workers) const;
+
+        Vec3 TracePixel(const TraceParameters& parameters, uint32_t x, uint32_t y, TraceStatistics& stats) const;
+    private:
+        struct Intersection {
+            Vec3 Pos;
+            int Face;
+        };
+
+        struct AABB {
+            Vec3 A, B;
+        };
+
+        struct Node {
+            uint32_t Ptr;
+            AABB Box;
+        };
+
+        // State of rayTrace for one pixel, so the packet path can bounce every lane on its own
+        struct Path {
+            Vec3 Res, Org, Dir;
+            Intersection P;
+            Vec3 Color;
+        };
+
+        // Cursor of getNodeFrom, without the TreeData path since the CPU port generates every level
+        struct Cursor {
+            uint32_t Level = 0;
+            uint32_t X = 0, Y = 0, Z = 0;
+        };
+
+        struct Packet;
+
+        void PrimaryRay(const TraceParameters& parameters, uint32_t x, uint32_t y, Vec3& pos, Vec3& dir) const;
+
+        Node GetNodeAt(Vec3 pos, Cursor& cursor, TraceStatistics& stats) const noexcept;
+
+        Intersection RayMarch(Intersection p, Vec3 dir, Traversal traversal, TraceStatistics& stats) const noexcept;
+
+        int MarchProfiler(Vec3 org, Vec3 dir, Traversal traversal, TraceStatistics& stats) const noexcept;
+
+        static Path StartPath(Vec3 org, Vec3 dir) noexcept;
+
+        // One iteration of the rayTrace loop after the march, true once the path is finished and Color is set
+        static bool Bounce(Path& path, float seed) noexcept;
+
+        void GetNodeAt(Packet& packet, int lanes, TraceStatistics& stats) const noexcept;
+
+        void RayMarch(Packet& packet, int lanes, Traversal traversal, TraceStatistics& stats) const noexcept;
+
+        void TraceQuad(const TraceParameters& parameters, uint32_t x, uint32_t y, float* rgba,
+                TraceStatistics& stats) const;
+
+        const Terrain& _terrain;
+    };
+}
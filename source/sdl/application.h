@@ -1,15 +1,24 @@
 #pragma once
 
+#include <array>
+#include <vector>
+#include <cstdint>
+#include <functional>
 #include "window.h"
 
 namespace SDL {
     class Application {
     public:
-        using SignalType = boost::signals2::signal<void(const SDL_Event&)>;
+        using Handler = std::function<void(const SDL_Event&)>;
 
-        template<class Func>
-        static auto Connect(int type, Func function) {
-            return _signals[type].connect(function);
+        // Main thread only, before Run. Handlers of one type run in the order they were connected
+        static void Connect(Uint32 type, Handler function) {
+            if (type >= _slots.size()) return;
+            if (_slots[type] == 0) {
+                _handlers.emplace_back();
+                _slots[type] = static_cast<uint8_t>(_handlers.size());
+            }
+            _handlers[_slots[type] - 1].push_back(std::move(function));
         }
 
         static void Init() {
@@ -34,7 +43,8 @@ namespace SDL {
 
     private:
         static void HandleEvent(const SDL_Event& event) {
-            _signals[event.type](event);
+            if (event.type >= _slots.size() || _slots[event.type] == 0) return;
+            for (auto& x : _handlers[_slots[event.type] - 1]) x(event);
         }
 
         static void DrainEvents(SDL_Event* event) {
@@ -54,6 +64,9 @@ namespace SDL {
         }
     private:
         inline static std::atomic_bool AppQuit = false;
-        inline static std::map<int, SignalType> _signals;
+        // Dispatch table: every event type maps to its handler list, 0 when nothing listens. One byte per type
+        // keeps the whole table in 64 KiB, of which the few blocks SDL actually sends stay in cache
+        inline static std::array<uint8_t, SDL_LASTEVENT> _slots {};
+        inline static std::vector<std::vector<Handler>> _handlers;
     };
 }
\ No newline at end of file
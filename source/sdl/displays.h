@@ -65,6 +65,8 @@ namespace SDL {
     public:
         static int Count() noexcept { return SDL_GetNumVideoDisplays(); }
 
+        static DisplayInfo Get(size_t index) noexcept { return DisplayInfo(index); }
+
         static std::vector<DisplayInfo> Enumerate() {
             std::vector<DisplayInfo> infos {static_cast<size_t>(Count())};
             for (auto i = 0; i < infos.size(); ++i) {
@@ -1,5 +1,5 @@
 #pragma once
-#include <map>
+#include <array>
 #include <atomic>
 #include <utility>
 #include <SDL2/SDL.h>
@@ -19,9 +19,10 @@ class Window {
 
         Window& operator=(Window&&) = delete;
 
+        // `type` is one of SDL_WindowEventID
         template<class Func>
         auto Connect(int type, Func function) {
-            return _signals[type].connect(function);
+            return _signals.at(type).connect(function);
         }
 
         Uint32 GetFlags() const noexcept { return SDL_GetWindowFlags(_window); }
@@ -40,6 +41,9 @@ class Window {
 
         void GetSize(int& w, int& h) const noexcept { SDL_GetWindowSize(_window, &w, &h); }
 
+        // Of the display the window's center is on, negative on failure
+        int GetDisplayIndex() const noexcept { return SDL_GetWindowDisplayIndex(_window); }
+
         bool TryGetBordersSize(int& top, int& left, int& bottom, int& right) const noexcept {
             return SDL_GetWindowBordersSize(_window, &top, &left, &bottom, &right)==0;
         }
@@ -141,7 +145,7 @@ class Window {
         }
 
         void TriggerEvent(const SDL_Event& event) {
-            _signals[event.window.event](*this, event);
+            if (event.window.event < _signals.size()) _signals[event.window.event](*this, event);
         }
 
         void SetReference(std::weak_ptr<Window> window) noexcept { _weak_ref = std::move(window); }
@@ -162,7 +166,7 @@ class Window {
 
         SDL_Window* _window;
         std::weak_ptr<Window> _weak_ref;
-        std::map<int, SignalType> _signals;
+        std::array<SignalType, 32> _signals; // By SDL_WindowEventID, which stays far below 32
         std::function<void()> _hitTestDestruct;
     };
 }
@@ -1,53 +1,77 @@
 #include "assets.h"
+#include "pack.h"
 
+#include <cstdlib>
 #include <fstream>
-#include <sstream>
 #include <SDL2/SDL_filesystem.h>
-#include <iostream>
 
 namespace Utils {
     namespace {
-        std::string DoGetDataPath() {
+        const char* GetOverride() {
+            const auto overridden = std::getenv("VXRT_ASSET_DIR");
+            return overridden && *overridden ? overridden : nullptr;
+        }
+
+        std::string GetBasePath() {
             char *base_path = SDL_GetBasePath();
             if (base_path) {
                 std::string ret {base_path};
                 SDL_free(base_path);
-                return ret + "/assets/";
+                return ret + "/";
             } else {
-                return "./assets/";
+                return "./";
             }
         }
 
-        std::string GetDataPath() {
-            static std::string dataPath = DoGetDataPath();
+        std::string DoGetDataPath() {
+            if (const auto overridden = GetOverride()) {
+                return std::string(overridden) + "/";
+            }
+            return GetBasePath() + "assets/";
+        }
+
+        const std::string& GetDataPath() {
+            static const std::string dataPath = DoGetDataPath();
             return dataPath;
         }
+
+        // Mapped once, for the lifetime of the process
+        const AssetPack* GetPack() {
+            static const std::unique_ptr<AssetPack> pack = GetOverride() ? nullptr
+                    : AssetPack::Open(GetBasePath() + "assets.vxpk");
+            return pack.get();
+        }
+    }
+
+    Assets::Blob Assets::Load(const std::string& rel) {
+        Blob blob;
+        if (const auto pack = GetPack()) {
+            if (const auto view = pack->Find(rel)) {
+                blob._view = *view;
+                return blob;
+            }
+        }
+        std::ifstream file(GetDataPath() + rel, std::ios::binary | std::ios::ate);
+        if (!file.good()) {
+            throw NotExist();
+        }
+        auto contents = std::make_shared<std::string>(static_cast<size_t>(file.tellg()), '\0');
+        file.seekg(0);
+        file.read(contents->data(), static_cast<std::streamsize>(contents->size()));
+        blob._view = *contents;
+        blob._owner = std::move(contents);
+        return blob;
     }
 
     std::string Assets::LoadFullText(const std::string& rel) {
-        std::ifstream t = LoadAsStream(rel);
-        std::stringstream buffer;
-        buffer << t.rdbuf();
-        return buffer.str();
+        return std::string(Load(rel).View());
     }
 
-    std::unique_ptr<char[]> Assets::LoadFullBytes(const std::string& rel) {
-        std::ifstream t = LoadAsStream(rel, std::ios::binary);
-        t.seekg(0, std::ios::end);
-        const auto size = t.tellg();
-        auto buffer = std::make_unique<char[]>(size);
-        t.seekg(0);
-        t.read(buffer.get(), size);
-        return buffer;
+    std::string Assets::GetDirectory() {
+        return GetDataPath();
     }
 
-    std::ifstream Assets::LoadAsStream(const std::string& rel, std::ios::openmode mode) {
-        auto fs = std::ifstream(GetDataPath() + rel, mode);
-        if (fs.good()) {
-            return fs;
-        }
-        else {
-            throw NotExist();
-        }
+    bool Assets::IsPacked() {
+        return GetPack() != nullptr;
     }
-}
\ No newline at end of file
+}
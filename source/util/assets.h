@@ -2,15 +2,36 @@
 
 #include <string>
 #include <memory>
-#include <fstream>
+#include <string_view>
 #include "exceptions.h"
 
 namespace Utils {
+    // Assets come from assets.vxpk next to the executable when it is there, and from the loose files of the assets
+    // directory otherwise (or when the pack lacks them). $VXRT_ASSET_DIR skips the pack and reads that directory
     class Assets {
     public:
         VXRT_EXCEPTION(NotExist, "Asset Does Not Exist");
-        static std::ifstream LoadAsStream(const std::string& rel, std::ios::openmode mode = 0);
+
+        // The bytes of one asset. Points into the mapped pack, or owns the contents of a loose file
+        class Blob {
+        public:
+            std::string_view View() const noexcept { return _view; }
+
+            const char* data() const noexcept { return _view.data(); }
+
+            size_t size() const noexcept { return _view.size(); }
+        private:
+            friend class Assets;
+
+            std::string_view _view;
+            std::shared_ptr<const std::string> _owner;
+        };
+
+        static Blob Load(const std::string& rel);
         static std::string LoadFullText(const std::string& rel);
-        static std::unique_ptr<char[]> LoadFullBytes(const std::string& rel);
+        // $VXRT_ASSET_DIR when set, so a run can read (and hot reload) the source tree's assets, otherwise the
+        // assets directory next to the executable
+        static std::string GetDirectory();
+        static bool IsPacked();
     };
 }
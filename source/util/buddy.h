@@ -0,0 +1,76 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <optional>
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace Utils {
+    // Hands out power of two ranges of [0, capacity). Every range starts at a multiple of its own size, so any
+    // power of two alignment up to the range size comes for free, at the cost of rounding requests up
+    class BuddyAllocator {
+    public:
+        // `capacity` and `minimum` are rounded up to powers of two
+        BuddyAllocator(uint64_t capacity, uint64_t minimum)
+                :_minimumOrder(Order(minimum)), _free(Order(capacity) - Order(minimum) + 1) {
+            _free.back().insert(0);
+        }
+
+        uint64_t GetCapacity() const noexcept { return uint64_t(1) << (_minimumOrder + _free.size() - 1); }
+
+        uint64_t GetUsed() const noexcept { return _used; }
+
+        bool IsEmpty() const noexcept { return _allocated.empty(); }
+
+        std::optional<uint64_t> Allocate(uint64_t size, uint64_t alignment) {
+            const auto order = Order(std::max(size, alignment));
+            const size_t level = order > _minimumOrder ? order - _minimumOrder : 0;
+            auto found = level;
+            while (found < _free.size() && _free[found].empty()) ++found;
+            if (found >= _free.size()) return std::nullopt;
+            const auto offset = *_free[found].begin();
+            _free[found].erase(_free[found].begin());
+            // Split down, the upper halves become free buddies
+            while (found > level) {
+                --found;
+                _free[found].insert(offset + GetSize(found));
+            }
+            _allocated.emplace(offset, level);
+            _used += GetSize(level);
+            return offset;
+        }
+
+        void Free(uint64_t offset) {
+            const auto it = _allocated.find(offset);
+            if (it == _allocated.end()) return;
+            auto level = it->second;
+            _allocated.erase(it);
+            _used -= GetSize(level);
+            // Merge with the buddy for as long as it is free too
+            while (level + 1 < _free.size()) {
+                const auto buddy = offset ^ GetSize(level);
+                const auto found = _free[level].find(buddy);
+                if (found == _free[level].end()) break;
+                _free[level].erase(found);
+                offset = std::min(offset, buddy);
+                ++level;
+            }
+            _free[level].insert(offset);
+        }
+    private:
+        static uint32_t Order(uint64_t size) noexcept {
+            uint32_t order = 0;
+            while ((uint64_t(1) << order) < size) ++order;
+            return order;
+        }
+
+        uint64_t GetSize(size_t level) const noexcept { return uint64_t(1) << (_minimumOrder + level); }
+
+        uint32_t _minimumOrder;
+        uint64_t _used = 0;
+        std::vector<std::unordered_set<uint64_t>> _free; // By level, level 0 holds ranges of the minimum size
+        std::unordered_map<uint64_t, size_t> _allocated;
+    };
+}
@@ -0,0 +1,103 @@
+#include "cache.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <cstdlib>
+#include <fstream>
+
+namespace Utils {
+    namespace {
+        std::filesystem::path FromEnvironment(const char* name, const char* suffix) {
+            if (auto value = std::getenv(name); value && *value) {
+                return std::filesystem::path(value) / suffix;
+            }
+            return {};
+        }
+
+        std::filesystem::path DoGetRoot() {
+            if (auto value = std::getenv("VXRT_CACHE_DIR"); value) {
+                return value;
+            }
+#ifdef _WIN32
+            return FromEnvironment("LOCALAPPDATA", "vxrt");
+#else
+            if (auto path = FromEnvironment("XDG_CACHE_HOME", "vxrt"); !path.empty()) {
+                return path;
+            }
+            return FromEnvironment("HOME", ".cache/vxrt");
+#endif
+        }
+
+        std::string TemporaryName(const std::string& key) {
+            static std::atomic<uint64_t> counter{0};
+            return key + ".tmp." + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + "."
+                   + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()) + "."
+                   + std::to_string(counter++);
+        }
+    }
+
+    DiskCache::DiskCache(const std::string& category) noexcept {
+        if (auto root = GetRoot(); !root.empty()) {
+            std::error_code ec;
+            auto directory = root / category;
+            std::filesystem::create_directories(directory, ec);
+            if (!ec) {
+                _directory = std::move(directory);
+            }
+        }
+    }
+
+    std::optional<std::vector<char>> DiskCache::Load(const std::string& key) const noexcept {
+        if (!IsEnabled()) return std::nullopt;
+        try {
+            std::ifstream file(_directory / key, std::ios::binary | std::ios::ate);
+            if (!file.good()) return std::nullopt;
+            const auto size = static_cast<size_t>(file.tellg());
+            std::vector<char> data(size);
+            file.seekg(0);
+            if (!file.read(data.data(), size)) return std::nullopt;
+            return data;
+        }
+        catch (...) {
+            return std::nullopt;
+        }
+    }
+
+    bool DiskCache::Store(const std::string& key, const void* data, size_t size) const noexcept {
+        if (!IsEnabled()) return false;
+        try {
+            const auto temporary = _directory / TemporaryName(key);
+            {
+                std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+                file.write(static_cast<const char*>(data), size);
+                if (!file.flush()) {
+                    file.close();
+                    std::error_code ec;
+                    std::filesystem::remove(temporary, ec);
+                    return false;
+                }
+            }
+            std::error_code ec;
+            std::filesystem::rename(temporary, _directory / key, ec);
+            if (ec) {
+                std::filesystem::remove(temporary, ec);
+                return false;
+            }
+            return true;
+        }
+        catch (...) {
+            return false;
+        }
+    }
+
+    std::filesystem::path DiskCache::GetRoot() noexcept {
+        try {
+            static const auto root = DoGetRoot();
+            return root;
+        }
+        catch (...) {
+            return {};
+        }
+    }
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <optional>
+#include <filesystem>
+
+namespace Utils {
+    // A directory of opaque blobs under the user cache directory. Every failure is treated as a miss, a
+    // broken cache must never keep the application from starting
+    class DiskCache {
+    public:
+        explicit DiskCache(const std::string& category) noexcept;
+
+        std::optional<std::vector<char>> Load(const std::string& key) const noexcept;
+
+        // Writes to a temporary file first and renames it over the entry, so readers (including other
+        // processes) see either the old or the new blob but never a partial one
+        bool Store(const std::string& key, const void* data, size_t size) const noexcept;
+
+        bool IsEnabled() const noexcept { return !_directory.empty(); }
+
+        // $VXRT_CACHE_DIR, otherwise the platform user cache directory. An empty $VXRT_CACHE_DIR disables caching
+        static std::filesystem::path GetRoot() noexcept;
+    private:
+        std::filesystem::path _directory;
+    };
+}
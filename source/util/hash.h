@@ -0,0 +1,45 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+#include <string_view>
+#include <type_traits>
+
+namespace Utils {
+    // Incremental 64 bit FNV-1a, used to build content addressed keys. Not suitable against adversarial input
+    class Hasher {
+    public:
+        Hasher& Add(const void* data, size_t size) noexcept {
+            auto bytes = static_cast<const unsigned char*>(data);
+            for (size_t i = 0; i < size; ++i) {
+                _state = (_state ^ bytes[i]) * Prime;
+            }
+            return *this;
+        }
+
+        // Strings are length prefixed, so ("ab", "c") and ("a", "bc") hash differently
+        Hasher& Add(std::string_view string) noexcept {
+            Add(static_cast<uint64_t>(string.size()));
+            return Add(string.data(), string.size());
+        }
+
+        Hasher& Add(const char* string) noexcept { return Add(std::string_view(string)); }
+
+        template <class T, class = std::enable_if_t<std::is_arithmetic_v<T> || std::is_enum_v<T>>>
+        Hasher& Add(T value) noexcept { return Add(&value, sizeof(value)); }
+
+        uint64_t Get() const noexcept { return _state; }
+
+        static std::string ToHex(uint64_t value) {
+            static constexpr char digits[] = "0123456789abcdef";
+            std::string result(16, '0');
+            for (int i = 15; i >= 0; --i, value >>= 4) {
+                result[i] = digits[value & 0xFu];
+            }
+            return result;
+        }
+    private:
+        static constexpr uint64_t Prime = 0x100000001b3ull;
+        uint64_t _state = 0xcbf29ce484222325ull;
+    };
+}
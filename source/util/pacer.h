@@ -0,0 +1,37 @@
+#pragma once
+
+#include <chrono>
+#include <thread>
+
+namespace Utils {
+    // Holds a loop to a fixed rate by sleeping until the next deadline. Deadlines advance by whole intervals, so
+    // an early frame does not drift the schedule; a loop that fell more than one interval behind starts a new
+    // schedule instead of racing to catch up
+    class FramePacer {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        // Zero disables pacing
+        explicit FramePacer(double framesPerSecond = 0.0) noexcept { SetRate(framesPerSecond); }
+
+        void SetRate(double framesPerSecond) noexcept {
+            _interval = framesPerSecond > 0.0
+                    ? std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / framesPerSecond))
+                    : Clock::duration::zero();
+            _next = Clock::now();
+        }
+
+        bool IsEnabled() const noexcept { return _interval != Clock::duration::zero(); }
+
+        void Wait() {
+            if (!IsEnabled()) return;
+            const auto now = Clock::now();
+            if (now > _next + _interval) _next = now;
+            else std::this_thread::sleep_until(_next);
+            _next += _interval;
+        }
+    private:
+        Clock::duration _interval {};
+        Clock::time_point _next {};
+    };
+}
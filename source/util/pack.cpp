@@ -0,0 +1,139 @@
+#include "pack.h"
+
+#include <cstring>
+#include <fstream>
+#include <algorithm>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+namespace Utils {
+    namespace {
+        constexpr uint64_t DataAlignment = 16;
+
+        uint64_t Align(uint64_t offset) noexcept {
+            return (offset + DataAlignment - 1) / DataAlignment * DataAlignment;
+        }
+
+        std::string_view Normalize(std::string_view name) noexcept {
+            while (!name.empty() && name.front() == '/') name.remove_prefix(1);
+            return name;
+        }
+    }
+
+    std::unique_ptr<AssetPack> AssetPack::Open(const std::filesystem::path& path) noexcept {
+        std::unique_ptr<AssetPack> pack(new AssetPack());
+#ifndef _WIN32
+        const int descriptor = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (descriptor < 0) return nullptr;
+        struct stat status{};
+        if (fstat(descriptor, &status) != 0 || status.st_size <= 0) {
+            close(descriptor);
+            return nullptr;
+        }
+        const auto size = static_cast<size_t>(status.st_size);
+        void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+        // The mapping keeps the file alive on its own
+        close(descriptor);
+        if (mapping == MAP_FAILED) return nullptr;
+        pack->_data = static_cast<const char*>(mapping);
+        pack->_size = size;
+        pack->_mapped = true;
+#else
+        try {
+            std::ifstream in(path, std::ios::binary | std::ios::ate);
+            if (!in) return nullptr;
+            pack->_copy.resize(static_cast<size_t>(in.tellg()));
+            in.seekg(0);
+            if (!in.read(pack->_copy.data(), static_cast<std::streamsize>(pack->_copy.size()))) return nullptr;
+        }
+        catch (...) {
+            return nullptr;
+        }
+        pack->_data = pack->_copy.data();
+        pack->_size = pack->_copy.size();
+#endif
+        if (!pack->Validate()) return nullptr;
+        return pack;
+    }
+
+    AssetPack::~AssetPack() {
+#ifndef _WIN32
+        if (_mapped) munmap(const_cast<char*>(_data), _size);
+#endif
+    }
+
+    bool AssetPack::Validate() noexcept {
+        if (_size < sizeof(Header)) return false;
+        Header header{};
+        std::memcpy(&header, _data, sizeof(header));
+        if (header.Magic != Magic || header.Version != Version) return false;
+        if (header.Count > (_size - sizeof(Header)) / sizeof(Entry)) return false;
+        _count = header.Count;
+        _entries = reinterpret_cast<const Entry*>(_data + sizeof(Header));
+        for (uint32_t i = 0; i < _count; ++i) {
+            const auto& entry = _entries[i];
+            if (entry.NameOffset > _size || entry.NameSize > _size - entry.NameOffset) return false;
+            if (entry.DataOffset > _size || entry.DataSize > _size - entry.DataOffset) return false;
+            // Lookups binary search the index
+            if (i > 0 && !(GetName(_entries[i - 1]) < GetName(entry))) return false;
+        }
+        return true;
+    }
+
+    std::string_view AssetPack::GetName(const Entry& entry) const noexcept {
+        return {_data + entry.NameOffset, entry.NameSize};
+    }
+
+    std::optional<std::string_view> AssetPack::Find(std::string_view name) const noexcept {
+        name = Normalize(name);
+        const auto end = _entries + _count;
+        const auto found = std::lower_bound(_entries, end, name,
+                [this](const Entry& entry, std::string_view key) { return GetName(entry) < key; });
+        if (found == end || GetName(*found) != name) return std::nullopt;
+        return std::string_view(_data + found->DataOffset, found->DataSize);
+    }
+
+    void AssetPack::Write(const std::filesystem::path& directory, const std::filesystem::path& output) {
+        std::vector<std::pair<std::string, std::filesystem::path>> files;
+        for (auto& item : std::filesystem::recursive_directory_iterator(directory)) {
+            if (!item.is_regular_file()) continue;
+            files.emplace_back(item.path().lexically_relative(directory).generic_string(), item.path());
+        }
+        std::sort(files.begin(), files.end());
+
+        const Header header{Magic, Version, static_cast<uint32_t>(files.size()), 0};
+        std::vector<Entry> entries(files.size());
+        std::string names;
+        uint64_t offset = sizeof(Header) + sizeof(Entry) * files.size();
+        for (size_t i = 0; i < files.size(); ++i) {
+            entries[i].NameOffset = static_cast<uint32_t>(offset + names.size());
+            entries[i].NameSize = static_cast<uint32_t>(files[i].first.size());
+            names += files[i].first;
+        }
+        offset = Align(offset + names.size());
+        for (size_t i = 0; i < files.size(); ++i) {
+            entries[i].DataOffset = offset;
+            entries[i].DataSize = std::filesystem::file_size(files[i].second);
+            offset = Align(offset + entries[i].DataSize);
+        }
+
+        std::ofstream out(output, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(entries.data()),
+                static_cast<std::streamsize>(entries.size() * sizeof(Entry)));
+        out.write(names.data(), static_cast<std::streamsize>(names.size()));
+        for (size_t i = 0; i < files.size(); ++i) {
+            const std::vector<char> padding(entries[i].DataOffset - static_cast<uint64_t>(out.tellp()), '\0');
+            out.write(padding.data(), static_cast<std::streamsize>(padding.size()));
+            // Streaming an empty file would fail the output stream
+            if (entries[i].DataSize == 0) continue;
+            std::ifstream in(files[i].second, std::ios::binary);
+            out << in.rdbuf();
+        }
+        if (!out) throw WriteFailure();
+    }
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <optional>
+#include <filesystem>
+#include <string_view>
+#include "exceptions.h"
+
+namespace Utils {
+    // A directory of assets in one file: a header, a name sorted index, the names, then every file 16 byte
+    // aligned. Opening maps the file read only and checks the index, lookups are a binary search returning a view
+    // straight into the mapping
+    class AssetPack {
+    public:
+        VXRT_EXCEPTION(WriteFailure, "Can Not Write Asset Pack")
+
+        static constexpr uint32_t Magic = 0x4b505856u; // "VXPK"
+        static constexpr uint32_t Version = 1u;
+
+        // Null when the file is missing or malformed
+        static std::unique_ptr<AssetPack> Open(const std::filesystem::path& path) noexcept;
+
+        // Packs every regular file below `directory` under its relative path, '/' separated
+        static void Write(const std::filesystem::path& directory, const std::filesystem::path& output);
+
+        AssetPack(const AssetPack&) = delete;
+
+        AssetPack& operator=(const AssetPack&) = delete;
+
+        ~AssetPack();
+
+        // Leading slashes are ignored. The view lives as long as the pack
+        std::optional<std::string_view> Find(std::string_view name) const noexcept;
+
+        uint32_t GetCount() const noexcept { return _count; }
+    private:
+        struct Header {
+            uint32_t Magic;
+            uint32_t Version;
+            uint32_t Count;
+            uint32_t Reserved;
+        };
+
+        struct Entry {
+            uint64_t DataOffset;
+            uint64_t DataSize;
+            uint32_t NameOffset;
+            uint32_t NameSize;
+        };
+
+        AssetPack() = default;
+
+        bool Validate() noexcept;
+
+        std::string_view GetName(const Entry& entry) const noexcept;
+
+        const char* _data = nullptr;
+        size_t _size = 0;
+        uint32_t _count = 0;
+        const Entry* _entries = nullptr;
+        bool _mapped = false;
+        std::vector<char> _copy; // Where memory mapping is not available
+    };
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <algorithm>
+
+namespace Utils {
+    // Nearest rank, `fraction` in [0, 1]. Takes the samples by value, they are partially reordered
+    inline double Percentile(std::vector<double> samples, double fraction) {
+        if (samples.empty()) return 0.0;
+        const auto rank = static_cast<size_t>(fraction * (samples.size() - 1) + 0.5);
+        std::nth_element(samples.begin(), samples.begin() + rank, samples.end());
+        return samples[rank];
+    }
+
+    // The last `capacity` samples of a series, for min / average / percentile readouts that follow the
+    // current behaviour instead of the whole run
+    class RollingStatistics {
+    public:
+        explicit RollingStatistics(size_t capacity = 256)
+                :_capacity(std::max<size_t>(capacity, 1)) { _samples.reserve(_capacity); }
+
+        void Push(double sample) {
+            if (_samples.size() < _capacity) _samples.push_back(sample);
+            else _samples[_next] = sample;
+            _next = (_next + 1) % _capacity;
+        }
+
+        size_t GetCount() const noexcept { return _samples.size(); }
+
+        double Min() const noexcept {
+            return _samples.empty() ? 0.0 : *std::min_element(_samples.begin(), _samples.end());
+        }
+
+        double Average() const noexcept {
+            double sum = 0.0;
+            for (auto x : _samples) sum += x;
+            return _samples.empty() ? 0.0 : sum / _samples.size();
+        }
+
+        // Nearest rank, `fraction` in [0, 1]
+        double Percentile(double fraction) const { return Utils::Percentile(_samples, fraction); }
+    private:
+        size_t _capacity;
+        size_t _next = 0;
+        std::vector<double> _samples;
+    };
+}
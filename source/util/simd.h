@@ -0,0 +1,244 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define VXRT_SIMD_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace Utils {
+    // Four lane float and uint vectors with just the operations the CPU side generators and tracers need.
+    // Lowers to SSE2 where available and to plain loops elsewhere, both produce identical bits
+    struct U32x4;
+
+    struct F32x4 {
+#ifdef VXRT_SIMD_SSE2
+        __m128 V;
+
+        F32x4() noexcept: V(_mm_setzero_ps()) { }
+
+        explicit F32x4(__m128 v) noexcept: V(v) { }
+
+        explicit F32x4(float x) noexcept: V(_mm_set1_ps(x)) { }
+
+        F32x4(float x, float y, float z, float w) noexcept: V(_mm_setr_ps(x, y, z, w)) { }
+
+        static F32x4 Load(const float* p) noexcept { return F32x4(_mm_loadu_ps(p)); }
+
+        void Store(float* p) const noexcept { _mm_storeu_ps(p, V); }
+
+        friend F32x4 operator+(F32x4 a, F32x4 b) noexcept { return F32x4(_mm_add_ps(a.V, b.V)); }
+
+        friend F32x4 operator-(F32x4 a, F32x4 b) noexcept { return F32x4(_mm_sub_ps(a.V, b.V)); }
+
+        friend F32x4 operator*(F32x4 a, F32x4 b) noexcept { return F32x4(_mm_mul_ps(a.V, b.V)); }
+
+        friend F32x4 operator/(F32x4 a, F32x4 b) noexcept { return F32x4(_mm_div_ps(a.V, b.V)); }
+
+        friend F32x4 Min(F32x4 a, F32x4 b) noexcept { return F32x4(_mm_min_ps(a.V, b.V)); }
+
+        friend F32x4 Max(F32x4 a, F32x4 b) noexcept { return F32x4(_mm_max_ps(a.V, b.V)); }
+
+        // Comparisons give all ones / all zeros lanes, to be consumed by Select and the bitwise operators
+        friend F32x4 operator<(F32x4 a, F32x4 b) noexcept { return F32x4(_mm_cmplt_ps(a.V, b.V)); }
+
+        friend F32x4 operator>(F32x4 a, F32x4 b) noexcept { return F32x4(_mm_cmpgt_ps(a.V, b.V)); }
+
+        friend F32x4 operator>=(F32x4 a, F32x4 b) noexcept { return F32x4(_mm_cmpge_ps(a.V, b.V)); }
+
+        friend F32x4 operator==(F32x4 a, F32x4 b) noexcept { return F32x4(_mm_cmpeq_ps(a.V, b.V)); }
+
+        friend F32x4 operator&(F32x4 a, F32x4 b) noexcept { return F32x4(_mm_and_ps(a.V, b.V)); }
+
+        friend F32x4 operator|(F32x4 a, F32x4 b) noexcept { return F32x4(_mm_or_ps(a.V, b.V)); }
+
+        // mask ? a : b per lane
+        friend F32x4 Select(F32x4 mask, F32x4 a, F32x4 b) noexcept {
+            return F32x4(_mm_or_ps(_mm_and_ps(mask.V, a.V), _mm_andnot_ps(mask.V, b.V)));
+        }
+
+        // Bit i set when lane i of a mask is set
+        int Bits() const noexcept { return _mm_movemask_ps(V); }
+
+        // Lanes 0 and 2 of a followed by lanes 0 and 2 of b
+        friend F32x4 EvenLanes(F32x4 a, F32x4 b) noexcept {
+            return F32x4(_mm_shuffle_ps(a.V, b.V, _MM_SHUFFLE(2, 0, 2, 0)));
+        }
+
+        friend F32x4 OddLanes(F32x4 a, F32x4 b) noexcept {
+            return F32x4(_mm_shuffle_ps(a.V, b.V, _MM_SHUFFLE(3, 1, 3, 1)));
+        }
+
+        float operator[](int i) const noexcept {
+            alignas(16) float lanes[4];
+            _mm_store_ps(lanes, V);
+            return lanes[i];
+        }
+#else
+        float V[4];
+
+        F32x4() noexcept: V{} { }
+
+        explicit F32x4(float x) noexcept: V{x, x, x, x} { }
+
+        F32x4(float x, float y, float z, float w) noexcept: V{x, y, z, w} { }
+
+        static F32x4 Load(const float* p) noexcept { return F32x4(p[0], p[1], p[2], p[3]); }
+
+        void Store(float* p) const noexcept { std::memcpy(p, V, sizeof(V)); }
+
+        template <class Op>
+        static F32x4 Map(F32x4 a, F32x4 b, Op op) noexcept {
+            return F32x4(op(a.V[0], b.V[0]), op(a.V[1], b.V[1]), op(a.V[2], b.V[2]), op(a.V[3], b.V[3]));
+        }
+
+        friend F32x4 operator+(F32x4 a, F32x4 b) noexcept { return Map(a, b, [](float x, float y) { return x + y; }); }
+
+        friend F32x4 operator-(F32x4 a, F32x4 b) noexcept { return Map(a, b, [](float x, float y) { return x - y; }); }
+
+        friend F32x4 operator*(F32x4 a, F32x4 b) noexcept { return Map(a, b, [](float x, float y) { return x * y; }); }
+
+        friend F32x4 operator/(F32x4 a, F32x4 b) noexcept { return Map(a, b, [](float x, float y) { return x / y; }); }
+
+        // Same operand order as minps/maxps, so NaN handling matches the SSE2 path
+        friend F32x4 Min(F32x4 a, F32x4 b) noexcept { return Map(a, b, [](float x, float y) { return x < y ? x : y; }); }
+
+        friend F32x4 Max(F32x4 a, F32x4 b) noexcept { return Map(a, b, [](float x, float y) { return x > y ? x : y; }); }
+
+        static float FromBits(uint32_t bits) noexcept {
+            float result;
+            std::memcpy(&result, &bits, sizeof(result));
+            return result;
+        }
+
+        static uint32_t ToBits(float value) noexcept {
+            uint32_t result;
+            std::memcpy(&result, &value, sizeof(result));
+            return result;
+        }
+
+        static float MaskOf(bool set) noexcept { return FromBits(set ? ~0u : 0u); }
+
+        friend F32x4 operator<(F32x4 a, F32x4 b) noexcept { return Map(a, b, [](float x, float y) { return MaskOf(x < y); }); }
+
+        friend F32x4 operator>(F32x4 a, F32x4 b) noexcept { return Map(a, b, [](float x, float y) { return MaskOf(x > y); }); }
+
+        friend F32x4 operator>=(F32x4 a, F32x4 b) noexcept { return Map(a, b, [](float x, float y) { return MaskOf(x >= y); }); }
+
+        friend F32x4 operator==(F32x4 a, F32x4 b) noexcept { return Map(a, b, [](float x, float y) { return MaskOf(x == y); }); }
+
+        friend F32x4 operator&(F32x4 a, F32x4 b) noexcept {
+            return Map(a, b, [](float x, float y) { return FromBits(ToBits(x) & ToBits(y)); });
+        }
+
+        friend F32x4 operator|(F32x4 a, F32x4 b) noexcept {
+            return Map(a, b, [](float x, float y) { return FromBits(ToBits(x) | ToBits(y)); });
+        }
+
+        friend F32x4 Select(F32x4 mask, F32x4 a, F32x4 b) noexcept {
+            F32x4 result;
+            for (int i = 0; i < 4; ++i) {
+                const auto m = ToBits(mask.V[i]);
+                result.V[i] = FromBits((ToBits(a.V[i]) & m) | (ToBits(b.V[i]) & ~m));
+            }
+            return result;
+        }
+
+        int Bits() const noexcept {
+            int result = 0;
+            for (int i = 0; i < 4; ++i) result |= static_cast<int>(ToBits(V[i]) >> 31u) << i;
+            return result;
+        }
+
+        friend F32x4 EvenLanes(F32x4 a, F32x4 b) noexcept { return F32x4(a.V[0], a.V[2], b.V[0], b.V[2]); }
+
+        friend F32x4 OddLanes(F32x4 a, F32x4 b) noexcept { return F32x4(a.V[1], a.V[3], b.V[1], b.V[3]); }
+
+        float operator[](int i) const noexcept { return V[i]; }
+#endif
+    };
+
+    struct U32x4 {
+#ifdef VXRT_SIMD_SSE2
+        __m128i V;
+
+        U32x4() noexcept: V(_mm_setzero_si128()) { }
+
+        explicit U32x4(__m128i v) noexcept: V(v) { }
+
+        explicit U32x4(uint32_t x) noexcept: V(_mm_set1_epi32(static_cast<int>(x))) { }
+
+        U32x4(uint32_t x, uint32_t y, uint32_t z, uint32_t w) noexcept
+                :V(_mm_setr_epi32(static_cast<int>(x), static_cast<int>(y), static_cast<int>(z), static_cast<int>(w))) { }
+
+        friend U32x4 operator+(U32x4 a, U32x4 b) noexcept { return U32x4(_mm_add_epi32(a.V, b.V)); }
+
+        friend U32x4 operator^(U32x4 a, U32x4 b) noexcept { return U32x4(_mm_xor_si128(a.V, b.V)); }
+
+        friend U32x4 operator&(U32x4 a, U32x4 b) noexcept { return U32x4(_mm_and_si128(a.V, b.V)); }
+
+        friend U32x4 operator|(U32x4 a, U32x4 b) noexcept { return U32x4(_mm_or_si128(a.V, b.V)); }
+
+        template <int N>
+        U32x4 ShiftLeft() const noexcept { return U32x4(_mm_slli_epi32(V, N)); }
+
+        template <int N>
+        U32x4 ShiftRight() const noexcept { return U32x4(_mm_srli_epi32(V, N)); }
+
+        static U32x4 Load(const uint32_t* p) noexcept { return U32x4(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p))); }
+
+        void Store(uint32_t* p) const noexcept { _mm_storeu_si128(reinterpret_cast<__m128i*>(p), V); }
+
+        // Reinterprets the bits, no conversion
+        F32x4 AsFloat() const noexcept { return F32x4(_mm_castsi128_ps(V)); }
+
+        // Rounds toward zero like uint(x) in GLSL, only defined for lanes in [0, 2^31)
+        static U32x4 Truncate(F32x4 x) noexcept { return U32x4(_mm_cvttps_epi32(x.V)); }
+#else
+        uint32_t V[4];
+
+        U32x4() noexcept: V{} { }
+
+        explicit U32x4(uint32_t x) noexcept: V{x, x, x, x} { }
+
+        U32x4(uint32_t x, uint32_t y, uint32_t z, uint32_t w) noexcept: V{x, y, z, w} { }
+
+        template <class Op>
+        static U32x4 Map(U32x4 a, U32x4 b, Op op) noexcept {
+            return U32x4(op(a.V[0], b.V[0]), op(a.V[1], b.V[1]), op(a.V[2], b.V[2]), op(a.V[3], b.V[3]));
+        }
+
+        friend U32x4 operator+(U32x4 a, U32x4 b) noexcept { return Map(a, b, [](uint32_t x, uint32_t y) { return x + y; }); }
+
+        friend U32x4 operator^(U32x4 a, U32x4 b) noexcept { return Map(a, b, [](uint32_t x, uint32_t y) { return x ^ y; }); }
+
+        friend U32x4 operator&(U32x4 a, U32x4 b) noexcept { return Map(a, b, [](uint32_t x, uint32_t y) { return x & y; }); }
+
+        friend U32x4 operator|(U32x4 a, U32x4 b) noexcept { return Map(a, b, [](uint32_t x, uint32_t y) { return x | y; }); }
+
+        template <int N>
+        U32x4 ShiftLeft() const noexcept { return U32x4(V[0] << N, V[1] << N, V[2] << N, V[3] << N); }
+
+        template <int N>
+        U32x4 ShiftRight() const noexcept { return U32x4(V[0] >> N, V[1] >> N, V[2] >> N, V[3] >> N); }
+
+        static U32x4 Load(const uint32_t* p) noexcept { return U32x4(p[0], p[1], p[2], p[3]); }
+
+        void Store(uint32_t* p) const noexcept { std::memcpy(p, V, sizeof(V)); }
+
+        F32x4 AsFloat() const noexcept {
+            F32x4 result;
+            std::memcpy(result.V, V, sizeof(V));
+            return result;
+        }
+
+        static U32x4 Truncate(F32x4 x) noexcept {
+            return U32x4(static_cast<uint32_t>(static_cast<int32_t>(x.V[0])), static_cast<uint32_t>(static_cast<int32_t>(x.V[1])),
+                    static_cast<uint32_t>(static_cast<int32_t>(x.V[2])), static_cast<uint32_t>(static_cast<int32_t>(x.V[3])));
+        }
+#endif
+    };
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+namespace Utils {
+    // Bounded wait-free queue between exactly one producer thread and one consumer thread. Each side keeps a
+    // cached copy of the other's index and only reloads it when the queue looks full or empty, so the shared
+    // cache lines move between cores once per burst instead of once per item
+    template <class T, size_t Capacity>
+    class SpscQueue {
+        static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+    public:
+        // Producer only. False when full, the value is dropped
+        bool TryPush(const T& value) noexcept {
+            const auto tail = _tail.load(std::memory_order_relaxed);
+            if (tail - _headCache == Capacity) {
+                _headCache = _head.load(std::memory_order_acquire);
+                if (tail - _headCache == Capacity) return false;
+            }
+            _items[tail & (Capacity - 1)] = value;
+            _tail.store(tail + 1, std::memory_order_release);
+            return true;
+        }
+
+        // Consumer only
+        bool TryPop(T& value) noexcept {
+            const auto head = _head.load(std::memory_order_relaxed);
+            if (head == _tailCache) {
+                _tailCache = _tail.load(std::memory_order_acquire);
+                if (head == _tailCache) return false;
+            }
+            value = _items[head & (Capacity - 1)];
+            _head.store(head + 1, std::memory_order_release);
+            return true;
+        }
+
+        // Consumer only. Hands everything pushed so far to `func`, in order, and returns how many
+        template <class Func>
+        size_t Drain(Func&& func) {
+            size_t count = 0;
+            for (T value; TryPop(value); ++count) func(value);
+            return count;
+        }
+    private:
+        static constexpr size_t CacheLine = 64;
+
+        alignas(CacheLine) std::atomic<size_t> _head {0};
+        size_t _tailCache = 0; // The consumer's
+        alignas(CacheLine) std::atomic<size_t> _tail {0};
+        size_t _headCache = 0; // The producer's
+        alignas(CacheLine) std::array<T, Capacity> _items {};
+    };
+}
@@ -0,0 +1,175 @@
+#pragma once
+
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <exception>
+#include <algorithm>
+#include <functional>
+#include <type_traits>
+#include <condition_variable>
+
+namespace Utils {
+    // Work stealing pool. Every worker owns a deque: tasks submitted from a worker go to the back of its own
+    // deque and are taken back LIFO (hot in cache), idle workers steal from the front of the others. Tasks
+    // submitted from outside are dealt round robin. Waiting inside the pool (ParallelFor) helps instead of
+    // blocking, so nested parallelism cannot starve the workers
+    class ThreadPool {
+    public:
+        // Zero picks one worker per hardware thread
+        explicit ThreadPool(size_t threads = 0) {
+            if (threads == 0) threads = std::max(std::thread::hardware_concurrency(), 1u);
+            _queues.reserve(threads);
+            for (size_t i = 0; i < threads; ++i) _queues.push_back(std::make_unique<Queue>());
+            _threads.reserve(threads);
+            for (size_t i = 0; i < threads; ++i) {
+                _threads.emplace_back([this, i]() { Worker(i); });
+            }
+        }
+
+        ThreadPool(const ThreadPool&) = delete;
+
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        // Runs everything already submitted before the workers are joined
+        ~ThreadPool() {
+            {
+                std::lock_guard<std::mutex> lock(_sleepLock);
+                _stop = true;
+            }
+            _signal.notify_all();
+            for (auto& x : _threads) x.join();
+        }
+
+        template <class Func>
+        auto Submit(Func&& func) {
+            using Result = std::invoke_result_t<std::decay_t<Func>>;
+            auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<Func>(func));
+            auto future = task->get_future();
+            const auto target = _currentPool == this ? _currentIndex : _next++ % _queues.size();
+            {
+                std::lock_guard<std::mutex> lock(_queues[target]->Lock);
+                _queues[target]->Tasks.emplace_back([task]() { (*task)(); });
+            }
+            ++_pending;
+            {
+                // Pairs with the predicate check in Worker, so a worker about to sleep cannot miss this task
+                std::lock_guard<std::mutex> lock(_sleepLock);
+            }
+            _signal.notify_one();
+            return future;
+        }
+
+        // Calls func(begin, end) over [0, count) in chunks of at most `grain` items and returns once all of them
+        // ran. The range is halved recursively, so thieves take the largest remaining pieces and the caller
+        // keeps the cache warm half for itself
+        template <class Func>
+        void ParallelFor(size_t count, size_t grain, Func func) {
+            if (count) Split(0, count, std::max<size_t>(grain, 1), func);
+        }
+
+        // Runs queued tasks until the future is ready. Only blocks once there is nothing left to take, at which
+        // point whatever the future waits on is already running on some worker
+        template <class T>
+        T Wait(std::future<T>& future) {
+            while (future.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+                if (!RunOne(_currentPool == this ? _currentIndex : 0)) {
+                    future.wait();
+                    break;
+                }
+            }
+            return future.get();
+        }
+
+        size_t GetThreadCount() const noexcept { return _threads.size(); }
+    private:
+        template <class Func>
+        void Split(size_t begin, size_t end, size_t grain, Func& func) {
+            std::vector<std::future<void>> pending;
+            while (end - begin > grain) {
+                const auto middle = begin + (end - begin) / 2;
+                pending.push_back(Submit([this, middle, end, grain, &func]() { Split(middle, end, grain, func); }));
+                end = middle;
+            }
+            // Every piece has to finish before func goes out of scope, even if one of them threw
+            std::exception_ptr error;
+            try {
+                func(begin, end);
+            }
+            catch (...) {
+                error = std::current_exception();
+            }
+            for (auto it = pending.rbegin(); it != pending.rend(); ++it) {
+                try {
+                    Wait(*it);
+                }
+                catch (...) {
+                    if (!error) error = std::current_exception();
+                }
+            }
+            if (error) std::rethrow_exception(error);
+        }
+
+        struct Queue {
+            std::mutex Lock;
+            std::deque<std::function<void()>> Tasks;
+        };
+
+        std::function<void()> TryPop(size_t index) {
+            auto& queue = *_queues[index];
+            std::lock_guard<std::mutex> lock(queue.Lock);
+            if (queue.Tasks.empty()) return {};
+            auto task = std::move(queue.Tasks.back());
+            queue.Tasks.pop_back();
+            return task;
+        }
+
+        std::function<void()> TrySteal(size_t thief) {
+            for (size_t i = 1; i < _queues.size(); ++i) {
+                auto& queue = *_queues[(thief + i) % _queues.size()];
+                std::lock_guard<std::mutex> lock(queue.Lock);
+                if (queue.Tasks.empty()) continue;
+                auto task = std::move(queue.Tasks.front());
+                queue.Tasks.pop_front();
+                return task;
+            }
+            return {};
+        }
+
+        bool RunOne(size_t home) {
+            auto task = TryPop(home);
+            if (!task) task = TrySteal(home);
+            if (!task) return false;
+            --_pending;
+            task();
+            return true;
+        }
+
+        void Worker(size_t index) {
+            _currentPool = this;
+            _currentIndex = index;
+            for (;;) {
+                if (RunOne(index)) continue;
+                std::unique_lock<std::mutex> lock(_sleepLock);
+                _signal.wait(lock, [this]() { return _stop || _pending > 0; });
+                if (_stop && _pending == 0) return;
+            }
+        }
+
+        inline static thread_local ThreadPool* _currentPool = nullptr;
+        inline static thread_local size_t _currentIndex = 0;
+
+        std::vector<std::unique_ptr<Queue>> _queues;
+        std::atomic<size_t> _next{0};
+        std::atomic<size_t> _pending{0};
+        std::mutex _sleepLock;
+        std::condition_variable _signal;
+        bool _stop = false;
+        std::vector<std::thread> _threads;
+    };
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+namespace Utils {
+    // Hands the newest value from one writer thread to one reader thread, wait-free on both sides. The writer
+    // fills the back slot and publishes it by swapping it with the middle one, the reader swaps the middle slot
+    // with its front one whenever a newer value is waiting. Values published in between are skipped
+    template <class T>
+    class TripleBuffer {
+    public:
+        // Writer only, the slot the next Publish hands over. Holds an old value, not the last published one
+        T& GetBack() noexcept { return _slots[_back]; }
+
+        // Writer only
+        void Publish() noexcept {
+            _back = _middle.exchange(static_cast<uint8_t>(_back | Fresh), std::memory_order_acq_rel) & Index;
+        }
+
+        // Reader only. The newest published value, the previous one again if nothing was published since, a
+        // default constructed T before the first Publish
+        const T& Read() noexcept {
+            if (_middle.load(std::memory_order_relaxed) & Fresh) {
+                _front = _middle.exchange(_front, std::memory_order_acq_rel) & Index;
+            }
+            return _slots[_front];
+        }
+    private:
+        static constexpr uint8_t Index = 3, Fresh = 4;
+
+        std::array<T, 3> _slots {};
+        uint8_t _back = 0; // The writer's
+        uint8_t _front = 1; // The reader's
+        alignas(64) std::atomic<uint8_t> _middle {2};
+    };
+}
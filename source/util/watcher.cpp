@@ -0,0 +1,81 @@
+#include "watcher.h"
+
+#include <algorithm>
+#include <system_error>
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/inotify.h>
+#endif
+
+namespace Utils {
+#ifndef __linux__
+    namespace {
+        std::map<std::string, std::filesystem::file_time_type> Scan(const std::filesystem::path& directory) {
+            std::map<std::string, std::filesystem::file_time_type> times;
+            std::error_code error;
+            for (auto it = std::filesystem::directory_iterator(directory, error);
+                 !error && it != std::filesystem::directory_iterator(); it.increment(error)) {
+                if (!it->is_regular_file(error)) continue;
+                times[it->path().filename().string()] = it->last_write_time(error);
+            }
+            return times;
+        }
+    }
+#endif
+
+    FileWatcher::FileWatcher(const std::filesystem::path& directory) noexcept
+            :_directory(directory) {
+        std::error_code error;
+        if (directory.empty() || !std::filesystem::is_directory(directory, error)) return;
+#ifdef __linux__
+        _descriptor = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (_descriptor < 0) return;
+        // Editors either write in place or write a temporary file and rename it over the original
+        if (inotify_add_watch(_descriptor, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+            close(_descriptor);
+            _descriptor = -1;
+            return;
+        }
+#else
+        _times = Scan(directory);
+        _lastScan = std::chrono::steady_clock::now();
+#endif
+        _enabled = true;
+    }
+
+    FileWatcher::~FileWatcher() {
+#ifdef __linux__
+        if (_descriptor >= 0) close(_descriptor);
+#endif
+    }
+
+    std::vector<std::string> FileWatcher::Poll() noexcept {
+        std::vector<std::string> changed;
+        if (!_enabled) return changed;
+#ifdef __linux__
+        alignas(inotify_event) char buffer[4096];
+        for (;;) {
+            const auto bytes = read(_descriptor, buffer, sizeof(buffer));
+            if (bytes <= 0) break;
+            for (ssize_t offset = 0; offset < bytes;) {
+                const auto event = reinterpret_cast<const inotify_event*>(buffer + offset);
+                if (event->len > 0) changed.emplace_back(event->name);
+                offset += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+            }
+        }
+#else
+        const auto now = std::chrono::steady_clock::now();
+        if (now - _lastScan < PollInterval) return changed;
+        _lastScan = now;
+        auto times = Scan(_directory);
+        for (auto& [name, time] : times) {
+            const auto previous = _times.find(name);
+            if (previous == _times.end() || previous->second != time) changed.push_back(name);
+        }
+        _times = std::move(times);
+#endif
+        std::sort(changed.begin(), changed.end());
+        changed.erase(std::unique(changed.begin(), changed.end()), changed.end());
+        return changed;
+    }
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <map>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <filesystem>
+
+namespace Utils {
+    // Reports files of one directory that were written or replaced, without blocking. Uses inotify on Linux and
+    // compares modification times elsewhere. Every failure leaves the watcher disabled instead of throwing
+    class FileWatcher {
+    public:
+        // An empty directory disables the watcher
+        explicit FileWatcher(const std::filesystem::path& directory) noexcept;
+
+        FileWatcher(const FileWatcher&) = delete;
+
+        FileWatcher& operator=(const FileWatcher&) = delete;
+
+        ~FileWatcher();
+
+        // Names, relative to the directory, of the files changed since the last call. Each name at most once
+        std::vector<std::string> Poll() noexcept;
+
+        bool IsEnabled() const noexcept { return _enabled; }
+    private:
+        std::filesystem::path _directory;
+        bool _enabled = false;
+        int _descriptor = -1;
+        // Polling fallback, rescanned at most every PollInterval
+        static constexpr std::chrono::milliseconds PollInterval{250};
+        std::chrono::steady_clock::time_point _lastScan;
+        std::map<std::string, std::filesystem::file_time_type> _times;
+    };
+}
@@ -0,0 +1,282 @@
+#pragma once
+
+#include <mutex>
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <algorithm>
+#include <utility>
+#include <ostream>
+#include <vulkan/vulkan.hpp>
+#include "../util/buddy.h"
+#include "../util/exceptions.h"
+
+namespace Vulkan {
+    class Allocator;
+
+    // A range of device memory owned by an Allocator, handed back to it on destruction
+    class Allocation {
+    public:
+        Allocation() noexcept = default;
+
+        Allocation(Allocation&& other) noexcept { *this = std::move(other); }
+
+        Allocation& operator=(Allocation&& other) noexcept {
+            if (this != &other) {
+                Release();
+                _owner = std::exchange(other._owner, nullptr);
+                _block = other._block;
+                _memory = std::exchange(other._memory, nullptr);
+                _offset = other._offset;
+                _size = other._size;
+                _mapped = std::exchange(other._mapped, nullptr);
+            }
+            return *this;
+        }
+
+        Allocation(const Allocation&) = delete;
+
+        Allocation& operator=(const Allocation&) = delete;
+
+        ~Allocation() { Release(); }
+
+        vk::DeviceMemory GetMemory() const noexcept { return _memory; }
+
+        vk::DeviceSize GetOffset() const noexcept { return _offset; }
+
+        vk::DeviceSize GetSize() const noexcept { return _size; }
+
+        // Null unless the memory is host visible
+        void* GetMapped() const noexcept { return _mapped; }
+
+        explicit operator bool() const noexcept { return static_cast<bool>(_memory); }
+    private:
+        friend class Allocator;
+
+        void Release() noexcept;
+
+        Allocator* _owner = nullptr;
+        size_t _block = 0;
+        vk::DeviceMemory _memory;
+        vk::DeviceSize _offset = 0;
+        vk::DeviceSize _size = 0;
+        void* _mapped = nullptr;
+    };
+
+    // Sub-allocates long lived resources out of large blocks of device memory, one list of blocks per memory
+    // type, so the scene needs a handful of vkAllocateMemory calls instead of one per resource. Blocks are
+    // split buddy style. Linear (buffers) and optimal (images) resources get blocks of their own when the
+    // device has a bufferImageGranularity above one, so they can never share a granularity page. Requests
+    // larger than a quarter of a block get dedicated memory. Host visible blocks stay mapped
+    class Allocator {
+    public:
+        VXRT_EXCEPTION(NoSuitableMemoryType, "No Suitable Memory Type")
+
+        static constexpr vk::DeviceSize DefaultBlockSize = vk::DeviceSize(64) << 20u;
+        static constexpr vk::DeviceSize MinimumAllocation = 256;
+
+        enum class Tiling { Linear, Optimal };
+
+        Allocator(vk::PhysicalDevice physical, vk::Device device, vk::DeviceSize blockSize = DefaultBlockSize)
+                :_device(device), _blockSize(blockSize), _properties(physical.getMemoryProperties()) {
+            const auto limits = physical.getProperties().limits;
+            _granularity = limits.bufferImageGranularity;
+            _allocationLimit = limits.maxMemoryAllocationCount;
+        }
+
+        Allocator(const Allocator&) = delete;
+
+        Allocator& operator=(const Allocator&) = delete;
+
+        // Every allocation must have been released by now
+        ~Allocator() {
+            for (auto& block : _blocks) {
+                if (block.Memory) _device.freeMemory(block.Memory);
+            }
+        }
+
+        uint32_t FindMemoryType(uint32_t typeBits, vk::MemoryPropertyFlags flags) const {
+            for (uint32_t i = 0; i < _properties.memoryTypeCount; ++i) {
+                if ((typeBits & (1u << i)) && (_properties.memoryTypes[i].propertyFlags & flags) == flags) {
+                    return i;
+                }
+            }
+            throw NoSuitableMemoryType();
+        }
+
+        Allocation Allocate(const vk::MemoryRequirements& requirements, vk::MemoryPropertyFlags flags,
+                Tiling tiling) {
+            const auto type = FindMemoryType(requirements.memoryTypeBits, flags);
+            const bool hostVisible = static_cast<bool>(
+                    _properties.memoryTypes[type].propertyFlags & vk::MemoryPropertyFlagBits::eHostVisible);
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (requirements.size > _blockSize / 4) {
+                return Bind(CreateBlock(type, tiling, requirements.size, hostVisible, true), 0, requirements.size);
+            }
+            for (size_t i = 0; i < _blocks.size(); ++i) {
+                auto& block = _blocks[i];
+                if (!block.Memory || block.Dedicated) continue;
+                if (block.Type != type || !Compatible(block.Resources, tiling)) continue;
+                if (const auto offset = block.Ranges->Allocate(requirements.size, requirements.alignment)) {
+                    return Bind(i, *offset, requirements.size);
+                }
+            }
+            const auto index = CreateBlock(type, tiling, _blockSize, hostVisible, false);
+            return Bind(index, *_blocks[index].Ranges->Allocate(requirements.size, requirements.alignment),
+                    requirements.size);
+        }
+
+        // vkAllocateMemory calls currently alive, against the device's maxMemoryAllocationCount
+        void Report(std::ostream& out) const {
+            std::lock_guard<std::mutex> lock(_mutex);
+            size_t count = 0;
+            vk::DeviceSize reserved = 0, used = 0;
+            for (auto& block : _blocks) {
+                if (!block.Memory) continue;
+                ++count;
+                reserved += block.Size;
+                used += block.Dedicated ? block.Size : block.Ranges->GetUsed();
+            }
+            out << "Device memory: " << count << " of " << _allocationLimit << " allocations, "
+                << (used >> 10u) << " KiB used of " << (reserved >> 10u) << " KiB" << std::endl;
+        }
+    private:
+        friend class Allocation;
+
+        struct Block {
+            vk::DeviceMemory Memory;
+            vk::DeviceSize Size = 0;
+            uint32_t Type = 0;
+            Tiling Resources = Tiling::Linear;
+            bool Dedicated = false;
+            void* Mapped = nullptr;
+            std::unique_ptr<Utils::BuddyAllocator> Ranges;
+        };
+
+        bool Compatible(Tiling a, Tiling b) const noexcept { return a == b || _granularity <= 1; }
+
+        size_t CreateBlock(uint32_t type, Tiling tiling, vk::DeviceSize size, bool hostVisible, bool dedicated) {
+            Block block;
+            block.Memory = _device.allocateMemory(vk::MemoryAllocateInfo(size, type));
+            block.Size = size;
+            block.Type = type;
+            block.Resources = tiling;
+            block.Dedicated = dedicated;
+            if (hostVisible) block.Mapped = _device.mapMemory(block.Memory, 0, VK_WHOLE_SIZE);
+            if (!dedicated) block.Ranges = std::make_unique<Utils::BuddyAllocator>(size, MinimumAllocation);
+            // Reuse the slot of a freed dedicated block
+            for (size_t i = 0; i < _blocks.size(); ++i) {
+                if (!_blocks[i].Memory) {
+                    _blocks[i] = std::move(block);
+                    return i;
+                }
+            }
+            _blocks.push_back(std::move(block));
+            return _blocks.size() - 1;
+        }
+
+        Allocation Bind(size_t index, vk::DeviceSize offset, vk::DeviceSize size) {
+            const auto& block = _blocks[index];
+            Allocation allocation;
+            allocation._owner = this;
+            allocation._block = index;
+            allocation._memory = block.Memory;
+            allocation._offset = offset;
+            allocation._size = size;
+            allocation._mapped = block.Mapped ? static_cast<char*>(block.Mapped) + offset : nullptr;
+            return allocation;
+        }
+
+        // Dedicated memory goes back to the device at once, sub-allocated blocks are kept for reuse
+        void Free(size_t index, vk::DeviceSize offset) noexcept {
+            std::lock_guard<std::mutex> lock(_mutex);
+            auto& block = _blocks[index];
+            if (!block.Dedicated) {
+                block.Ranges->Free(offset);
+                return;
+            }
+            _device.freeMemory(block.Memory);
+            block = {};
+        }
+
+        vk::Device _device;
+        vk::DeviceSize _blockSize;
+        vk::DeviceSize _granularity = 1;
+        uint32_t _allocationLimit = 0;
+        vk::PhysicalDeviceMemoryProperties _properties;
+        mutable std::mutex _mutex;
+        std::vector<Block> _blocks;
+    };
+
+    inline void Allocation::Release() noexcept {
+        if (_owner) _owner->Free(_block, _offset);
+        _owner = nullptr;
+        _memory = nullptr;
+        _mapped = nullptr;
+    }
+
+    // Bump allocated host visible memory for data that lives one frame. One buffer holds a region per frame slot,
+    // so a single descriptor reaches every slot through dynamic offsets, and a region is rewound when its slot
+    // comes around again and its previous frame has retired
+    class FrameArena {
+    public:
+        VXRT_EXCEPTION(ArenaExhausted, "Frame Arena Exhausted")
+
+        struct Slice {
+            vk::Buffer Buffer;
+            vk::DeviceSize Offset = 0; // From the start of the buffer, usable as a dynamic offset
+            void* Mapped = nullptr;
+        };
+
+        // `capacity` is per slot
+        FrameArena(vk::PhysicalDevice physical, vk::Device device, Allocator& allocator, uint32_t framesInFlight,
+                vk::DeviceSize capacity, vk::BufferUsageFlags usage) {
+            const auto limits = physical.getProperties().limits;
+            // Covers every way a slice may be bound, and keeps flushes of non coherent memory on atom boundaries
+            _alignment = std::max({limits.minUniformBufferOffsetAlignment, limits.minStorageBufferOffsetAlignment,
+                    limits.nonCoherentAtomSize, vk::DeviceSize(16)});
+            _capacity = Align(capacity);
+            _slots = std::max(framesInFlight, 1u);
+            _handle = device.createBufferUnique(vk::BufferCreateInfo({}, _capacity * _slots, usage,
+                    vk::SharingMode::eExclusive));
+            _memory = allocator.Allocate(device.getBufferMemoryRequirements(_handle.get()),
+                    vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
+                    Allocator::Tiling::Linear);
+            device.bindBufferMemory(_handle.get(), _memory.GetMemory(), _memory.GetOffset());
+        }
+
+        FrameArena(const FrameArena&) = delete;
+
+        FrameArena& operator=(const FrameArena&) = delete;
+
+        // Call once the slot's previous frame has retired, before allocating for the new one
+        void Begin(uint32_t slot) noexcept {
+            _base = (slot % _slots) * _capacity;
+            _top = 0;
+        }
+
+        Slice Allocate(vk::DeviceSize size) {
+            const auto offset = Align(_top);
+            if (offset + size > _capacity) throw ArenaExhausted();
+            _top = offset + size;
+            return {_handle.get(), _base + offset, static_cast<char*>(_memory.GetMapped()) + _base + offset};
+        }
+
+        vk::Buffer GetBuffer() const noexcept { return _handle.get(); }
+
+        vk::DeviceSize GetAlignment() const noexcept { return _alignment; }
+    private:
+        vk::DeviceSize Align(vk::DeviceSize size) const noexcept {
+            return (size + _alignment - 1) / _alignment * _alignment;
+        }
+
+        vk::DeviceSize _alignment = 16;
+        vk::DeviceSize _capacity = 0;
+        uint32_t _slots = 1;
+        vk::DeviceSize _base = 0;
+        vk::DeviceSize _top = 0;
+        // The buffer goes before the memory bound to it
+        Allocation _memory;
+        vk::UniqueBuffer _handle;
+    };
+}
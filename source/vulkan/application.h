@@ -44,13 +44,12 @@ namespace Vulkan {
     class Application {
     public:
         static void CreateInstance(const InstanceCreateInfo& create) {
-            auto appInfo = vk::ApplicationInfo(create.AppName, create.AppVer, create.EngineName, create.EngineVer, VK_API_VERSION_1_1);
-            auto extensions = GetInstanceRequiredExtensions(create.Extensions);
-            Instance = vk::createInstanceUnique({
-                    {}, &appInfo,
-                    0, nullptr,
-                    static_cast<uint32_t>(extensions.size()), extensions.data()
-            });
+            CreateInstanceWithExtensions(create, GetInstanceRequiredExtensions(create.Extensions));
+        }
+
+        // Skips the SDL surface extension query, so no video subsystem or window has to exist
+        static void CreateHeadlessInstance(const InstanceCreateInfo& create) {
+            CreateInstanceWithExtensions(create, create.Extensions);
         }
 
         static auto EnumeratePhysicalDevices() {
@@ -67,6 +66,16 @@ namespace Vulkan {
                             vk::UniqueSurfaceKHR(surface, {Instance.get()})));
         }
     private:
+        static void CreateInstanceWithExtensions(const InstanceCreateInfo& create,
+                const std::vector<const char*>& extensions) {
+            auto appInfo = vk::ApplicationInfo(create.AppName, create.AppVer, create.EngineName, create.EngineVer, VK_API_VERSION_1_2);
+            Instance = vk::createInstanceUnique({
+                    {}, &appInfo,
+                    0, nullptr,
+                    static_cast<uint32_t>(extensions.size()), extensions.data()
+            });
+        }
+
         [[noreturn]] static void VulkanHandleSDLError() {
             throw std::runtime_error(SDL_GetError());
         }
@@ -2,50 +2,271 @@
 
 #include <any>
 #include <map>
+#include <mutex>
+#include <chrono>
+#include <cstdlib>
 #include <string>
+#include <utility>
 #include <memory>
 #include <vector>
+#include <iomanip>
+#include <ostream>
+#include <typeinfo>
+#include <algorithm>
+#include <exception>
+#include <condition_variable>
+#ifdef __GNUG__
+#include <cxxabi.h>
+#endif
 #include "../util/exceptions.h"
+#include "../util/thread_pool.h"
 
 namespace Vulkan {
     class Builder;
 
+    // Names a value of type T the steps hand each other. Declared once as a constant, so Push and Fetch can
+    // only be used with the type the key names
+    template <class T>
+    struct Key {
+        const char* Name;
+    };
+
+    // State the builder does not hold, such as parts of the object being built. Only used to order the steps
+    using Token = Key<void>;
+
+    // What a step reads and writes. A step runs once every earlier step writing what it reads, or reading or
+    // writing what it writes, has finished. Steps that declare nothing run alone, in order
+    class Dependencies {
+    public:
+        template <class T>
+        Dependencies& Reads(Key<T> key) {
+            _reads.emplace_back(key.Name);
+            return *this;
+        }
+
+        template <class T>
+        Dependencies& Writes(Key<T> key) {
+            _writes.emplace_back(key.Name);
+            return *this;
+        }
+    private:
+        friend class Builder;
+
+        bool Touches(const std::vector<std::string>& names) const {
+            return std::any_of(names.begin(), names.end(), [this](const std::string& name) {
+                return Has(_reads, name) || Has(_writes, name);
+            });
+        }
+
+        static bool Has(const std::vector<std::string>& names, const std::string& name) {
+            return std::find(names.begin(), names.end(), name) != names.end();
+        }
+
+        bool IsSerial() const noexcept { return _reads.empty() && _writes.empty(); }
+
+        std::vector<std::string> _reads, _writes;
+    };
+
     class IBuilder {
     public:
         virtual ~IBuilder() noexcept = default;
         virtual void Build(Builder& builder) = 0;
+        virtual void Declare(Dependencies&) const { }
+    };
+
+    // Wall clock of every step of one Build, in milliseconds since it started
+    class BuildTimeline {
+    public:
+        struct Step {
+            std::string Name;
+            double Start, Duration;
+            bool Critical; // On the chain of waits that ended with the last step to finish
+        };
+
+        void Print(std::ostream& out) const {
+            double busy = 0.0;
+            for (auto& x : Steps) busy += x.Duration;
+            const auto flags = out.flags();
+            out << std::fixed << std::setprecision(1) << "Startup: " << Wall << "ms, " << busy
+                << "ms of steps, * on the critical path" << std::endl;
+            for (auto& x : Steps) {
+                out << (x.Critical ? "  * " : "    ") << std::setw(8) << x.Start << "ms +" << std::setw(8)
+                    << x.Duration << "ms " << x.Name << std::endl;
+            }
+            out.flags(flags);
+        }
+
+        std::vector<Step> Steps;
+        double Wall = 0.0;
     };
 
+    // Runs the steps on a thread pool, each as soon as the earlier steps it depends on (see Dependencies)
+    // are done, so the result is the same as running them in the order they were added
     class Builder {
     public:
+        VXRT_EXCEPTION(UndeclaredKey, "Build Step Uses A Key It Did Not Declare")
+        VXRT_EXCEPTION(InputWritten, "Build Step Writes A Key Pushed Before Building")
+
+        // Before Build, pushes inputs every step may read. During Build, only what the step declares it writes
         template <class T>
-        auto& Push(const std::string& name, const T& object) {
-           _results.insert_or_assign(name, std::any(object));
-           return *this;
+        auto& Push(Key<T> key, const T& object) {
+            static_assert(!std::is_void_v<T>, "Tokens carry no value");
+            std::lock_guard<std::mutex> lock(_lock);
+            if (const auto declared = GetDeclared()) {
+                if (!Dependencies::Has(declared->_writes, key.Name)) throw UndeclaredKey();
+            }
+            else {
+                _inputs.emplace_back(key.Name);
+            }
+            _results.insert_or_assign(key.Name, std::any(object));
+            return *this;
         }
 
         template <class T, class ...Ts, class = std::is_convertible<T*, IBuilder*>>
         auto& Use(Ts&&... args) {
-            _builders.push_back(std::make_unique<T>(std::forward<Ts>(args)...));
+            _builders.push_back({std::make_unique<T>(std::forward<Ts>(args)...), Demangle(typeid(T).name()), {}});
             return *this;
         }
 
-        void Build() {
-            for (auto&& x : _builders) {
-                x->Build(*this);
+        template <class T>
+        T& Fetch(Key<T> key) {
+            static_assert(!std::is_void_v<T>, "Tokens carry no value");
+            std::lock_guard<std::mutex> lock(_lock);
+            const auto declared = GetDeclared();
+            if (declared && !Dependencies::Has(_inputs, key.Name) && !declared->Touches({key.Name})) {
+                throw UndeclaredKey();
             }
+            return *Utils::RequireNonNull(std::any_cast<T>(&_results[key.Name]));
         }
 
-        std::any& Fetch(const std::string& name) {
-            return _results[name];
-        }
+        // Rethrows the first exception a step threw, once the steps already running are done. Steps depending
+        // on a failed one never start
+        BuildTimeline Build() {
+            const auto count = _builders.size();
+            std::vector<std::vector<size_t>> dependents(count), dependencies(count);
+            std::vector<size_t> remaining(count);
+            std::vector<size_t> ready;
+            for (size_t i = 0; i < count; ++i) {
+                auto& step = _builders[i];
+                step.Step->Declare(step.Declared);
+                for (auto& name : step.Declared._writes) {
+                    if (Dependencies::Has(_inputs, name)) throw InputWritten();
+                }
+                for (size_t j = 0; j < i; ++j) {
+                    if (!MustPrecede(_builders[j].Declared, step.Declared)) continue;
+                    dependents[j].push_back(i);
+                    dependencies[i].push_back(j);
+                    ++remaining[i];
+                }
+                if (remaining[i] == 0) ready.push_back(i);
+            }
 
-        template <class T>
-        T& Fetch(const std::string& name) {
-            return *Utils::RequireNonNull(std::any_cast<T>(&Fetch(name)));
+            using Clock = std::chrono::steady_clock;
+            const auto start = Clock::now();
+            const auto since = [start]() {
+                return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+            };
+            BuildTimeline timeline;
+            timeline.Steps.resize(count);
+            std::mutex lock;
+            std::condition_variable finished;
+            size_t running = 0;
+            std::exception_ptr error;
+            {
+                // Steps mostly wait on the device or the shader compiler, a few threads are plenty
+                Utils::ThreadPool pool(std::max<size_t>(std::min<size_t>(count, 4), 1));
+                std::unique_lock<std::mutex> guard(lock);
+                for (;;) {
+                    while (!error && !ready.empty()) {
+                        // In the order they were added, when there is a choice
+                        const auto first = std::min_element(ready.begin(), ready.end());
+                        const auto index = *first;
+                        ready.erase(first);
+                        ++running;
+                        pool.Submit([&, index]() {
+                            auto& step = _builders[index];
+                            const auto begin = since();
+                            std::exception_ptr failure;
+                            try {
+                                _current = {this, &step.Declared};
+                                step.Step->Build(*this);
+                            }
+                            catch (...) {
+                                failure = std::current_exception();
+                            }
+                            _current = {};
+                            std::lock_guard<std::mutex> done(lock);
+                            timeline.Steps[index] = {step.Name, begin, since() - begin, false};
+                            if (failure && !error) error = failure;
+                            for (auto next : dependents[index]) {
+                                if (--remaining[next] == 0) ready.push_back(next);
+                            }
+                            --running;
+                            finished.notify_one();
+                        });
+                    }
+                    if (running == 0) break;
+                    finished.wait(guard);
+                }
+            }
+            if (error) std::rethrow_exception(error);
+            timeline.Wall = since();
+            MarkCriticalPath(timeline, dependencies);
+            return timeline;
         }
     private:
+        struct Entry {
+            std::unique_ptr<IBuilder> Step;
+            std::string Name;
+            Dependencies Declared;
+        };
+
+        static bool MustPrecede(const Dependencies& earlier, const Dependencies& later) {
+            return earlier.IsSerial() || later.IsSerial() || earlier.Touches(later._writes) ||
+                   later.Touches(earlier._writes);
+        }
+
+        // Walks back from the last step to finish through the dependency each step waited on longest
+        static void MarkCriticalPath(BuildTimeline& timeline, const std::vector<std::vector<size_t>>& dependencies) {
+            auto& steps = timeline.Steps;
+            const auto end = [&](size_t i) { return steps[i].Start + steps[i].Duration; };
+            if (steps.empty()) return;
+            size_t current = 0;
+            for (size_t i = 1; i < steps.size(); ++i) {
+                if (end(i) > end(current)) current = i;
+            }
+            for (;;) {
+                steps[current].Critical = true;
+                const auto& waited = dependencies[current];
+                if (waited.empty()) break;
+                current = *std::max_element(waited.begin(), waited.end(),
+                        [&](size_t a, size_t b) { return end(a) < end(b); });
+            }
+        }
+
+        // Without the namespaces, the step types live in anonymous ones
+        static std::string Demangle(const char* mangled) {
+            std::string name = mangled;
+#ifdef __GNUG__
+            int status = 0;
+            if (auto readable = abi::__cxa_demangle(mangled, nullptr, nullptr, &status)) {
+                name = readable;
+                std::free(readable);
+            }
+#endif
+            const auto scope = name.rfind("::");
+            return scope == std::string::npos ? name : name.substr(scope + 2);
+        }
+
+        // What the step running on this thread declared, if it belongs to this builder
+        const Dependencies* GetDeclared() const noexcept {
+            return _current.first == this ? _current.second : nullptr;
+        }
+
+        std::mutex _lock;
         std::map<std::string, std::any> _results;
-        std::vector<std::unique_ptr<IBuilder>> _builders;
+        std::vector<std::string> _inputs;
+        std::vector<Entry> _builders;
+        inline static thread_local std::pair<const Builder*, const Dependencies*> _current{};
     };
 }
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <array>
+#include <limits>
+#include <cstdint>
+#include <initializer_list>
+#include <vulkan/vulkan.hpp>
+#include "../util/exceptions.h"
+
+namespace Vulkan {
+    // Semaphores ordering a submission after work on another queue (Wait, at WaitStage) and work on another
+    // queue after it (Signal). Either may be null. The values are for timeline semaphores, binary ones ignore them
+    struct Handoff {
+        vk::Semaphore Wait;
+        vk::PipelineStageFlags WaitStage;
+        vk::Semaphore Signal;
+        uint64_t WaitValue = 0, SignalValue = 0;
+    };
+
+    class Commands {
+    public:
+        VXRT_EXCEPTION(TooManyHandoffs, "Too Many Semaphore Handoffs In One Submission")
+
+        static constexpr size_t MaxHandoffs = 4;
+
+        // Records and submits a throwaway command buffer and blocks until the queue has executed it.
+        // Only meant for setup work, never for anything on the per-frame path
+        template <class Func>
+        static void SubmitOnce(vk::Device device, vk::Queue queue, uint32_t family, Func record,
+                const Handoff& handoff = {}) {
+            auto pool = device.createCommandPoolUnique(
+                    vk::CommandPoolCreateInfo(vk::CommandPoolCreateFlagBits::eTransient, family));
+            auto buffers = device.allocateCommandBuffersUnique(
+                    vk::CommandBufferAllocateInfo(pool.get(), vk::CommandBufferLevel::ePrimary, 1));
+            auto cmd = buffers[0].get();
+            cmd.begin(vk::CommandBufferBeginInfo(vk::CommandBufferUsageFlagBits::eOneTimeSubmit));
+            record(cmd);
+            cmd.end();
+            auto fence = device.createFenceUnique({});
+            Submit(queue, cmd, {handoff}, fence.get());
+            device.waitForFences(fence.get(), true, std::numeric_limits<uint64_t>::max());
+        }
+
+        // Every wait and signal of `handoffs` in one submission, null semaphores are skipped. The timeline values
+        // are chained only when one of them is set, so binary hand-offs work on devices without timelines
+        static void Submit(vk::Queue queue, vk::CommandBuffer cmd, std::initializer_list<Handoff> handoffs,
+                vk::Fence fence) {
+            if (handoffs.size() > MaxHandoffs) throw TooManyHandoffs();
+            std::array<vk::Semaphore, MaxHandoffs> waits, signals;
+            std::array<vk::PipelineStageFlags, MaxHandoffs> stages;
+            std::array<uint64_t, MaxHandoffs> waitValues {}, signalValues {};
+            uint32_t waitCount = 0, signalCount = 0;
+            bool timeline = false;
+            for (const auto& x : handoffs) {
+                if (x.Wait) {
+                    stages[waitCount] = x.WaitStage;
+                    waitValues[waitCount] = x.WaitValue;
+                    waits[waitCount++] = x.Wait;
+                }
+                if (x.Signal) {
+                    signalValues[signalCount] = x.SignalValue;
+                    signals[signalCount++] = x.Signal;
+                }
+                timeline = timeline || x.WaitValue || x.SignalValue;
+            }
+            const vk::TimelineSemaphoreSubmitInfo values(waitCount, waitValues.data(), signalCount,
+                    signalValues.data());
+            vk::SubmitInfo info(waitCount, waits.data(), stages.data(), 1, &cmd, signalCount, signals.data());
+            if (timeline) info.pNext = &values;
+            queue.submit(info, fence);
+        }
+
+        static void TransitionImage(vk::CommandBuffer cmd, vk::Image image, uint32_t mipLevels,
+                vk::ImageLayout from, vk::ImageLayout to,
+                vk::AccessFlags srcAccess, vk::AccessFlags dstAccess,
+                vk::PipelineStageFlags srcStage, vk::PipelineStageFlags dstStage) {
+            vk::ImageMemoryBarrier barrier(srcAccess, dstAccess, from, to, VK_QUEUE_FAMILY_IGNORED,
+                    VK_QUEUE_FAMILY_IGNORED, image,
+                    vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, mipLevels, 0, 1));
+            cmd.pipelineBarrier(srcStage, dstStage, {}, nullptr, nullptr, barrier);
+        }
+    };
+
+    // Hands a buffer or image from one queue family to another. Release is recorded on the source queue and
+    // acquire on the destination queue, whose submission waits (at the acquiring stage) for a semaphore the
+    // release submission signals, or follows a host wait on its fence. Between queues of one family the release
+    // records nothing and the acquire is an ordinary barrier, the semaphore already makes the writes visible
+    class QueueTransfer {
+    public:
+        QueueTransfer(uint32_t from, uint32_t to) noexcept
+                :_from(from), _to(to) { }
+
+        bool IsOwnershipTransfer() const noexcept { return _from != _to; }
+
+        void ReleaseBuffer(vk::CommandBuffer cmd, vk::Buffer buffer, vk::AccessFlags srcAccess,
+                vk::PipelineStageFlags srcStage) const {
+            if (!IsOwnershipTransfer()) return;
+            cmd.pipelineBarrier(srcStage, vk::PipelineStageFlagBits::eBottomOfPipe, {}, nullptr,
+                    vk::BufferMemoryBarrier(srcAccess, {}, _from, _to, buffer, 0, VK_WHOLE_SIZE), nullptr);
+        }
+
+        void AcquireBuffer(vk::CommandBuffer cmd, vk::Buffer buffer, vk::AccessFlags dstAccess,
+                vk::PipelineStageFlags dstStage) const {
+            cmd.pipelineBarrier(dstStage, dstStage, {}, nullptr,
+                    vk::BufferMemoryBarrier({}, dstAccess, GetFrom(), GetTo(), buffer, 0, VK_WHOLE_SIZE), nullptr);
+        }
+
+        // The layout transition happens once, as part of both halves
+        void ReleaseImage(vk::CommandBuffer cmd, vk::Image image, uint32_t mipLevels, vk::ImageLayout from,
+                vk::ImageLayout to, vk::AccessFlags srcAccess, vk::PipelineStageFlags srcStage) const {
+            if (!IsOwnershipTransfer()) return;
+            cmd.pipelineBarrier(srcStage, vk::PipelineStageFlagBits::eBottomOfPipe, {}, nullptr, nullptr,
+                    vk::ImageMemoryBarrier(srcAccess, {}, from, to, _from, _to, image, GetRange(mipLevels)));
+        }
+
+        void AcquireImage(vk::CommandBuffer cmd, vk::Image image, uint32_t mipLevels, vk::ImageLayout from,
+                vk::ImageLayout to, vk::AccessFlags dstAccess, vk::PipelineStageFlags dstStage) const {
+            cmd.pipelineBarrier(dstStage, dstStage, {}, nullptr, nullptr,
+                    vk::ImageMemoryBarrier({}, dstAccess, from, to, GetFrom(), GetTo(), image, GetRange(mipLevels)));
+        }
+    private:
+        uint32_t GetFrom() const noexcept { return IsOwnershipTransfer() ? _from : VK_QUEUE_FAMILY_IGNORED; }
+
+        uint32_t GetTo() const noexcept { return IsOwnershipTransfer() ? _to : VK_QUEUE_FAMILY_IGNORED; }
+
+        static vk::ImageSubresourceRange GetRange(uint32_t mipLevels) noexcept {
+            return {vk::ImageAspectFlagBits::eColor, 0, mipLevels, 0, 1};
+        }
+
+        uint32_t _from, _to;
+    };
+}
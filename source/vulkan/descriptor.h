@@ -0,0 +1,79 @@
+#pragma once
+
+#include <deque>
+#include <vector>
+#include <unordered_map>
+#include <vulkan/vulkan.hpp>
+#include "reflection.h"
+
+namespace Vulkan {
+    // Hands out descriptor sets from pools kept per set layout. Each pool is sized for SetsPerPool sets of its
+    // layout exactly, so pools never fragment, and a new one is only created once the last is full
+    class DescriptorAllocator {
+    public:
+        static constexpr uint32_t SetsPerPool = 8;
+
+        explicit DescriptorAllocator(vk::Device device) noexcept
+                :_device(device) { }
+
+        DescriptorAllocator(const DescriptorAllocator&) = delete;
+
+        DescriptorAllocator& operator=(const DescriptorAllocator&) = delete;
+
+        vk::DescriptorSet Allocate(const ShaderLayout& shaders, vk::DescriptorSetLayout layout, uint32_t set = 0) {
+            auto& pools = _pools[static_cast<VkDescriptorSetLayout>(layout)];
+            if (pools.Pools.empty() || pools.Remaining == 0) {
+                auto sizes = shaders.GetPoolSizes(set);
+                for (auto& size : sizes) size.descriptorCount *= SetsPerPool;
+                pools.Pools.push_back(_device.createDescriptorPoolUnique(vk::DescriptorPoolCreateInfo({},
+                        SetsPerPool, static_cast<uint32_t>(sizes.size()), sizes.data())));
+                pools.Remaining = SetsPerPool;
+            }
+            --pools.Remaining;
+            return _device.allocateDescriptorSets(vk::DescriptorSetAllocateInfo(pools.Pools.back().get(), 1,
+                    &layout)).front();
+        }
+    private:
+        struct LayoutPools {
+            std::vector<vk::UniqueDescriptorPool> Pools;
+            uint32_t Remaining = 0;
+        };
+
+        vk::Device _device;
+        std::unordered_map<VkDescriptorSetLayout, LayoutPools> _pools;
+    };
+
+    // Collects descriptor writes by binding name and submits them in a single vkUpdateDescriptorSets call
+    class DescriptorWriter {
+    public:
+        explicit DescriptorWriter(vk::Device device) noexcept
+                :_device(device) { }
+
+        DescriptorWriter& Buffer(const ShaderLayout& shaders, vk::DescriptorSet set, const std::string& name,
+                vk::DescriptorBufferInfo info) {
+            const auto& binding = shaders.Find(name);
+            _writes.emplace_back(set, binding.Binding, 0, 1, binding.Type, nullptr, &_buffers.emplace_back(info));
+            return *this;
+        }
+
+        DescriptorWriter& Image(const ShaderLayout& shaders, vk::DescriptorSet set, const std::string& name,
+                vk::DescriptorImageInfo info) {
+            const auto& binding = shaders.Find(name);
+            _writes.emplace_back(set, binding.Binding, 0, 1, binding.Type, &_images.emplace_back(info));
+            return *this;
+        }
+
+        void Flush() {
+            if (!_writes.empty()) _device.updateDescriptorSets(_writes, nullptr);
+            _writes.clear();
+            _buffers.clear();
+            _images.clear();
+        }
+    private:
+        vk::Device _device;
+        std::vector<vk::WriteDescriptorSet> _writes;
+        // Deques keep the infos where the writes point at while more are added
+        std::deque<vk::DescriptorBufferInfo> _buffers;
+        std::deque<vk::DescriptorImageInfo> _images;
+    };
+}
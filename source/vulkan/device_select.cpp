@@ -0,0 +1,203 @@
+#include "device_select.h"
+
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <algorithm>
+#include <filesystem>
+
+namespace Vulkan {
+    namespace {
+        int64_t ScoreType(vk::PhysicalDeviceType type) noexcept {
+            switch (type) {
+                case vk::PhysicalDeviceType::eDiscreteGpu: return 10000;
+                case vk::PhysicalDeviceType::eIntegratedGpu: return 5000;
+                case vk::PhysicalDeviceType::eVirtualGpu: return 2000;
+                case vk::PhysicalDeviceType::eCpu: return 1000;
+                default: return 0;
+            }
+        }
+
+        const char* DescribeType(vk::PhysicalDeviceType type) noexcept {
+            switch (type) {
+                case vk::PhysicalDeviceType::eDiscreteGpu: return "discrete";
+                case vk::PhysicalDeviceType::eIntegratedGpu: return "integrated";
+                case vk::PhysicalDeviceType::eVirtualGpu: return "virtual";
+                case vk::PhysicalDeviceType::eCpu: return "cpu";
+                default: return "other";
+            }
+        }
+
+        std::string Lower(std::string text) {
+            std::transform(text.begin(), text.end(), text.begin(),
+                    [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+            return text;
+        }
+
+        std::string Trim(const std::string& text) {
+            const auto begin = text.find_first_not_of(" \t\r\n");
+            if (begin == std::string::npos) return {};
+            return text.substr(begin, text.find_last_not_of(" \t\r\n") - begin + 1);
+        }
+
+        // Lower case hex digits only, empty unless it is a whole UUID
+        std::string NormalizeUuid(const std::string& text) {
+            std::string digits;
+            for (const auto c : text) {
+                if (c == '-') continue;
+                if (!std::isxdigit(static_cast<unsigned char>(c))) return {};
+                digits += static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+            }
+            return digits.size() == VK_UUID_SIZE * 2 ? digits : std::string();
+        }
+
+        std::filesystem::path GetConfigFile() {
+#ifdef _WIN32
+            const auto root = std::getenv("APPDATA");
+            if (root && *root) return std::filesystem::path(root) / "vxrt" / "device";
+#else
+            if (const auto root = std::getenv("XDG_CONFIG_HOME"); root && *root) {
+                return std::filesystem::path(root) / "vxrt" / "device";
+            }
+            if (const auto home = std::getenv("HOME"); home && *home) {
+                return std::filesystem::path(home) / ".config" / "vxrt" / "device";
+            }
+#endif
+            return {};
+        }
+
+        // What the renderer samples and renders into, see AccumulationTargetBuilder and SceneResourceBuilder
+        bool SupportsFormats(vk::PhysicalDevice device) {
+            const auto target = device.getFormatProperties(vk::Format::eR32G32B32A32Sfloat).optimalTilingFeatures;
+            const auto texture = device.getFormatProperties(vk::Format::eR32Sfloat).optimalTilingFeatures;
+            const auto renderable = vk::FormatFeatureFlagBits::eColorAttachment |
+                                    vk::FormatFeatureFlagBits::eSampledImage;
+            return (target & renderable) == renderable && (texture & vk::FormatFeatureFlagBits::eSampledImage);
+        }
+    }
+
+    DeviceCandidate DeviceSelector::Evaluate(vk::PhysicalDevice device) const {
+        DeviceCandidate candidate;
+        candidate.Device = device;
+        const auto properties = device.getProperties();
+        candidate.Name = properties.deviceName;
+        candidate.Type = properties.deviceType;
+        if (properties.apiVersion < VK_API_VERSION_1_1) {
+            candidate.Rejected = "needs Vulkan 1.1";
+            return candidate;
+        }
+        const auto identity = device.getProperties2<vk::PhysicalDeviceProperties2, vk::PhysicalDeviceIDProperties>();
+        candidate.Uuid = FormatUuid(&identity.get<vk::PhysicalDeviceIDProperties>().deviceUUID[0]);
+
+        const auto memory = device.getMemoryProperties();
+        for (uint32_t i = 0; i < memory.memoryHeapCount; ++i) {
+            if (memory.memoryHeaps[i].flags & vk::MemoryHeapFlagBits::eDeviceLocal) {
+                candidate.DeviceLocal += memory.memoryHeaps[i].size;
+            }
+        }
+
+        const auto families = device.getQueueFamilyProperties();
+        bool graphics = false, present = !_surface, compute = false, transfer = false;
+        for (uint32_t i = 0; i < families.size(); ++i) {
+            const auto flags = families[i].queueFlags;
+            if (families[i].queueCount == 0) continue;
+            graphics = graphics || static_cast<bool>(flags & vk::QueueFlagBits::eGraphics);
+            present = present || device.getSurfaceSupportKHR(i, _surface);
+            compute = compute || (flags & vk::QueueFlagBits::eCompute && !(flags & vk::QueueFlagBits::eGraphics));
+            transfer = transfer || (flags & vk::QueueFlagBits::eTransfer &&
+                                    !(flags & (vk::QueueFlagBits::eGraphics | vk::QueueFlagBits::eCompute)));
+        }
+        const auto available = device.enumerateDeviceExtensionProperties();
+        for (const auto extension : _extensions) {
+            const auto found = std::any_of(available.begin(), available.end(), [extension](const auto& x) {
+                return std::strcmp(x.extensionName, extension) == 0;
+            });
+            if (!found) candidate.Rejected = std::string("lacks ") + extension;
+        }
+        if (!graphics) candidate.Rejected = "has no graphics queue";
+        else if (!present) candidate.Rejected = "can not present to the window";
+        else if (!SupportsFormats(device)) candidate.Rejected = "can not render to 32 bit float targets";
+        if (!candidate.Rejected.empty()) return candidate;
+
+        // The type decides, memory (up to 64 GiB) breaks ties between devices of one type
+        candidate.Score = ScoreType(candidate.Type) +
+                          static_cast<int64_t>(std::min<vk::DeviceSize>(candidate.DeviceLocal >> 20u, 65536) / 16);
+        if (compute) candidate.Score += 100;
+        if (transfer) candidate.Score += 100;
+        if (device.getFeatures().pipelineStatisticsQuery) candidate.Score += 50;
+        return candidate;
+    }
+
+    vk::PhysicalDevice DeviceSelector::Select(const std::vector<vk::PhysicalDevice>& devices,
+            const std::optional<DevicePreference>& preference, std::ostream& log) const {
+        std::vector<DeviceCandidate> candidates;
+        log << "Devices:" << std::endl;
+        for (const auto device : devices) {
+            const auto& x = candidates.emplace_back(Evaluate(device));
+            log << "  " << x.Name << " [" << x.Uuid << "] " << DescribeType(x.Type) << ", "
+                << (x.DeviceLocal >> 20u) << " MiB device local: ";
+            if (x.Rejected.empty()) log << "score " << x.Score << std::endl;
+            else log << "rejected, " << x.Rejected << std::endl;
+        }
+        const auto better = [](const DeviceCandidate* best, const DeviceCandidate& x) {
+            return x.Rejected.empty() && (!best || x.Score > best->Score);
+        };
+        const DeviceCandidate* best = nullptr;
+        const DeviceCandidate* preferred = nullptr;
+        for (const auto& x : candidates) {
+            if (better(best, x)) best = &x;
+            if (preference && Matches(x, preference->Value)) {
+                if (!x.Rejected.empty()) {
+                    log << "Device " << x.Name << " from " << preference->Source << " is not usable, ignored"
+                        << std::endl;
+                }
+                else if (better(preferred, x)) {
+                    preferred = &x;
+                }
+            }
+        }
+        if (!best) throw NoSuitableDevice();
+        if (preferred) {
+            log << "Selected " << preferred->Name << ", matches \"" << preference->Value << "\" from "
+                << preference->Source << std::endl;
+            return preferred->Device;
+        }
+        if (preference) {
+            log << "No usable device matches \"" << preference->Value << "\" from " << preference->Source
+                << std::endl;
+        }
+        log << "Selected " << best->Name << ", highest score" << std::endl;
+        return best->Device;
+    }
+
+    std::optional<DevicePreference> DeviceSelector::GetPreference() {
+        if (const auto value = std::getenv("VXRT_DEVICE"); value && !Trim(value).empty()) {
+            return DevicePreference{Trim(value), "VXRT_DEVICE"};
+        }
+        const auto path = GetConfigFile();
+        std::ifstream file(path);
+        std::string line;
+        while (file && std::getline(file, line)) {
+            if (auto value = Trim(line); !value.empty()) return DevicePreference{std::move(value), path.string()};
+        }
+        return std::nullopt;
+    }
+
+    bool DeviceSelector::Matches(const DeviceCandidate& candidate, const std::string& preference) {
+        const auto uuid = NormalizeUuid(preference);
+        if (!uuid.empty()) return uuid == NormalizeUuid(candidate.Uuid);
+        return !preference.empty() && Lower(candidate.Name).find(Lower(preference)) != std::string::npos;
+    }
+
+    std::string DeviceSelector::FormatUuid(const uint8_t* bytes) {
+        static constexpr char Digits[] = "0123456789abcdef";
+        std::string text;
+        for (size_t i = 0; i < VK_UUID_SIZE; ++i) {
+            if (i == 4 || i == 6 || i == 8 || i == 10) text += '-';
+            text += Digits[bytes[i] >> 4u];
+            text += Digits[bytes[i] & 0xfu];
+        }
+        return text;
+    }
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <ostream>
+#include <optional>
+#include <vulkan/vulkan.hpp>
+#include "../util/exceptions.h"
+
+namespace Vulkan {
+    struct DeviceCandidate {
+        vk::PhysicalDevice Device;
+        std::string Name;
+        std::string Uuid; // xxxxxxxx-xxxx-xxxx-xxxx-xxxxxxxxxxxx, stable across runs and driver updates
+        vk::PhysicalDeviceType Type{};
+        vk::DeviceSize DeviceLocal{}; // Bytes over all device local heaps
+        int64_t Score{};
+        std::string Rejected; // Why the device can not run the renderer, empty when it can
+    };
+
+    // A device the user asked for, by (part of) its name or by its UUID
+    struct DevicePreference {
+        std::string Value;
+        std::string Source; // Where it came from, for the log
+    };
+
+    // Picks a physical device without asking anyone. Devices missing what the renderer needs are rejected, the
+    // rest are scored on their type first, then device local memory, dedicated compute and transfer queue
+    // families and the optional features the profiler uses. A preference overrides the score as long as the
+    // device it names is usable
+    class DeviceSelector {
+    public:
+        VXRT_EXCEPTION(NoSuitableDevice, "No Vulkan Device Can Run The Renderer")
+
+        // A surface also requires a queue family that can present to it
+        explicit DeviceSelector(std::vector<const char*> extensions = {}, vk::SurfaceKHR surface = {})
+                :_extensions(std::move(extensions)), _surface(surface) { }
+
+        DeviceCandidate Evaluate(vk::PhysicalDevice device) const;
+
+        // Logs every candidate and the decision
+        vk::PhysicalDevice Select(const std::vector<vk::PhysicalDevice>& devices,
+                const std::optional<DevicePreference>& preference, std::ostream& log) const;
+
+        // $VXRT_DEVICE, otherwise the first line of vxrt/device in the user config directory
+        static std::optional<DevicePreference> GetPreference();
+
+        // A full UUID, dashes optional, or a case insensitive part of the name
+        static bool Matches(const DeviceCandidate& candidate, const std::string& preference);
+
+        static std::string FormatUuid(const uint8_t* bytes);
+    private:
+        std::vector<const char*> _extensions;
+        vk::SurfaceKHR _surface;
+    };
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <limits>
+#include <vector>
+#include <algorithm>
+#include <vulkan/vulkan.hpp>
+#include "command.h"
+
+namespace Vulkan {
+    // Everything one frame in flight owns. The command buffer belongs to the pool, which is reset as a whole
+    struct FrameSlot {
+        vk::UniqueCommandPool Pool;
+        vk::CommandBuffer Commands;
+        vk::UniqueFence Fence;
+        vk::UniqueSemaphore ImageAcquired;
+        vk::UniqueSemaphore RenderFinished;
+        uint32_t Index{};
+    };
+
+    // Round robin over N frame slots, so the host records frame N+1 while the device still executes frame N
+    class FrameRing {
+    public:
+        FrameRing(vk::Device device, uint32_t queueFamily, uint32_t framesInFlight)
+                :_device(device), _slots(std::max(framesInFlight, 1u)) {
+            for (uint32_t i = 0; i < _slots.size(); ++i) {
+                auto& slot = _slots[i];
+                slot.Index = i;
+                slot.Pool = device.createCommandPoolUnique(
+                        vk::CommandPoolCreateInfo(vk::CommandPoolCreateFlagBits::eTransient, queueFamily));
+                slot.Commands = device.allocateCommandBuffers(
+                        vk::CommandBufferAllocateInfo(slot.Pool.get(), vk::CommandBufferLevel::ePrimary, 1))[0];
+                slot.Fence = device.createFenceUnique(vk::FenceCreateInfo(vk::FenceCreateFlagBits::eSignaled));
+                slot.ImageAcquired = device.createSemaphoreUnique({});
+                slot.RenderFinished = device.createSemaphoreUnique({});
+            }
+        }
+
+        FrameRing(const FrameRing&) = delete;
+
+        FrameRing& operator=(const FrameRing&) = delete;
+
+        ~FrameRing() { WaitIdle(); }
+
+        // Blocks until the device has retired the last frame recorded into the next slot, then opens its
+        // command buffer for recording. The fence is left signaled until Submit, so bailing out between
+        // the two never leaves a slot that can not be waited on
+        FrameSlot& Acquire() {
+            auto& slot = _slots[_frame++ % _slots.size()];
+            _device.waitForFences(slot.Fence.get(), true, std::numeric_limits<uint64_t>::max());
+            _device.resetCommandPool(slot.Pool.get(), {});
+            slot.Commands.begin(vk::CommandBufferBeginInfo(vk::CommandBufferUsageFlagBits::eOneTimeSubmit));
+            return slot;
+        }
+
+        void Submit(vk::Queue queue, FrameSlot& slot, std::initializer_list<Handoff> handoffs) {
+            slot.Commands.end();
+            _device.resetFences(slot.Fence.get());
+            Commands::Submit(queue, slot.Commands, handoffs, slot.Fence.get());
+        }
+
+        // Blocks until the given frame, one of the last GetFramesInFlight() handed out, has been retired
+        void WaitFrame(uint64_t frame) {
+            _device.waitForFences(_slots[frame % _slots.size()].Fence.get(), true,
+                    std::numeric_limits<uint64_t>::max());
+        }
+
+        void WaitIdle() {
+            for (auto& slot : _slots) {
+                _device.waitForFences(slot.Fence.get(), true, std::numeric_limits<uint64_t>::max());
+            }
+        }
+
+        uint32_t GetFramesInFlight() const noexcept { return static_cast<uint32_t>(_slots.size()); }
+
+        uint64_t GetFrameNumber() const noexcept { return _frame; }
+    private:
+        vk::Device _device;
+        std::vector<FrameSlot> _slots;
+        uint64_t _frame = 0;
+    };
+}
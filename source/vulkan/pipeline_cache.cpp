@@ -0,0 +1,60 @@
+#include "pipeline_cache.h"
+#include <cstring>
+#include "../util/hash.h"
+
+namespace Vulkan {
+    namespace {
+        // VkPipelineCacheHeaderVersionOne, spelled out since it is only given in prose by the spec
+        struct CacheHeader {
+            uint32_t HeaderSize;
+            uint32_t HeaderVersion;
+            uint32_t VendorID;
+            uint32_t DeviceID;
+            uint8_t Uuid[VK_UUID_SIZE];
+        };
+        static_assert(sizeof(CacheHeader) == 16 + VK_UUID_SIZE);
+    }
+
+    PipelineCache::PipelineCache(vk::PhysicalDevice physical, vk::Device device)
+            :_device(device), _properties(physical.getProperties()), _disk("pipeline") {
+        // One entry per device and driver, so machines with several GPUs do not evict each other
+        _name = Utils::Hasher::ToHex(Utils::Hasher()
+                .Add(_properties.vendorID)
+                .Add(_properties.deviceID)
+                .Add(_properties.driverVersion)
+                .Add(_properties.pipelineCacheUUID, VK_UUID_SIZE)
+                .Get()) + ".bin";
+        if (auto blob = _disk.Load(_name); blob && Validate(*blob)) {
+            try {
+                _cache = device.createPipelineCacheUnique(vk::PipelineCacheCreateInfo({}, blob->size(), blob->data()));
+                _seededSize = blob->size();
+                return;
+            }
+            catch (vk::SystemError&) {
+                // The driver rejected the blob anyway, start over with an empty cache
+            }
+        }
+        _cache = device.createPipelineCacheUnique(vk::PipelineCacheCreateInfo());
+    }
+
+    bool PipelineCache::Validate(const std::vector<char>& blob) const noexcept {
+        if (blob.size() < sizeof(CacheHeader)) return false;
+        CacheHeader header{};
+        std::memcpy(&header, blob.data(), sizeof(header));
+        return header.HeaderSize >= sizeof(CacheHeader) && header.HeaderSize <= blob.size() &&
+               header.HeaderVersion == static_cast<uint32_t>(vk::PipelineCacheHeaderVersion::eOne) &&
+               header.VendorID == _properties.vendorID && header.DeviceID == _properties.deviceID &&
+               std::memcmp(header.Uuid, _properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+    }
+
+    bool PipelineCache::Save() noexcept {
+        if (!_cache || !_disk.IsEnabled()) return false;
+        try {
+            const auto data = _device.getPipelineCacheData(_cache.get());
+            return !data.empty() && _disk.Store(_name, data.data(), data.size());
+        }
+        catch (...) {
+            return false;
+        }
+    }
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <string>
+#include <vulkan/vulkan.hpp>
+#include "../util/cache.h"
+
+namespace Vulkan {
+    // A vk::PipelineCache seeded from the user cache directory and written back when destroyed.
+    // Blobs whose header does not match this exact device and driver are discarded instead of handed
+    // to the driver
+    class PipelineCache {
+    public:
+        PipelineCache(vk::PhysicalDevice physical, vk::Device device);
+
+        PipelineCache(const PipelineCache&) = delete;
+
+        PipelineCache& operator=(const PipelineCache&) = delete;
+
+        ~PipelineCache() { Save(); }
+
+        vk::PipelineCache Get() const noexcept { return _cache.get(); }
+
+        // True when the cache was seeded from a valid blob of a previous run
+        bool IsWarm() const noexcept { return _seededSize > 0; }
+
+        size_t GetSeededSize() const noexcept { return _seededSize; }
+
+        bool Save() noexcept;
+    private:
+        bool Validate(const std::vector<char>& blob) const noexcept;
+
+        vk::Device _device;
+        vk::PhysicalDeviceProperties _properties;
+        Utils::DiskCache _disk;
+        std::string _name;
+        vk::UniquePipelineCache _cache;
+        size_t _seededSize{};
+    };
+}
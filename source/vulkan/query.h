@@ -0,0 +1,139 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <fstream>
+#include <algorithm>
+#include <ostream>
+#include <vulkan/vulkan.hpp>
+#include "../util/rolling.h"
+
+namespace Vulkan {
+    // GPU time and fragment shader invocations of every pass of a frame. Each frame slot owns its own range of
+    // queries, which is read back when the slot is recorded into again: by then FrameRing::Acquire has waited
+    // on the slot's fence, so collecting never stalls the device or the host. Without timestamp support on
+    // the queue the profiler stays disabled and records nothing
+    class GpuProfiler {
+    public:
+        GpuProfiler(vk::PhysicalDevice physical, vk::Device device, uint32_t queueFamily, bool pipelineStatistics,
+                uint32_t framesInFlight, std::vector<std::string> passes)
+                :_device(device), _passes(std::move(passes)), _slots(std::max(framesInFlight, 1u)) {
+            const auto properties = physical.getProperties();
+            const auto validBits = physical.getQueueFamilyProperties()[queueFamily].timestampValidBits;
+            if (validBits == 0 || _passes.empty()) return;
+            _period = properties.limits.timestampPeriod;
+            _mask = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+            const auto count = static_cast<uint32_t>(_slots.size() * _passes.size());
+            _timestamps = device.createQueryPoolUnique(vk::QueryPoolCreateInfo({}, vk::QueryType::eTimestamp,
+                    count * 2));
+            if (pipelineStatistics) {
+                _statistics = device.createQueryPoolUnique(vk::QueryPoolCreateInfo({},
+                        vk::QueryType::ePipelineStatistics, count,
+                        vk::QueryPipelineStatisticFlagBits::eFragmentShaderInvocations));
+            }
+            _milliseconds.resize(_passes.size());
+            _invocations.resize(_passes.size());
+        }
+
+        GpuProfiler(const GpuProfiler&) = delete;
+
+        GpuProfiler& operator=(const GpuProfiler&) = delete;
+
+        bool IsEnabled() const noexcept { return static_cast<bool>(_timestamps); }
+
+        // Appends one "frame,pass,milliseconds,fragment_invocations" row per collected pass from now on
+        void OpenCsv(const std::string& path) {
+            _csv.open(path, std::ios::out | std::ios::trunc);
+            if (_csv) _csv << "frame,pass,milliseconds,fragment_invocations\n";
+        }
+
+        // First thing recorded into a slot's command buffer, right after FrameRing::Acquire
+        void BeginFrame(vk::CommandBuffer cmd, uint32_t slot, uint64_t frame) {
+            if (!IsEnabled()) return;
+            auto& state = _slots[slot];
+            if (state.Recorded) Collect(slot, state.Frame);
+            const auto count = static_cast<uint32_t>(_passes.size());
+            cmd.resetQueryPool(_timestamps.get(), slot * count * 2, count * 2);
+            if (_statistics) cmd.resetQueryPool(_statistics.get(), slot * count, count);
+            state.Recorded = true;
+            state.Frame = frame;
+        }
+
+        // Outside of render passes, the statistics query has to end where it began
+        void BeginPass(vk::CommandBuffer cmd, uint32_t slot, uint32_t pass) {
+            if (!IsEnabled()) return;
+            const auto index = slot * static_cast<uint32_t>(_passes.size()) + pass;
+            cmd.writeTimestamp(vk::PipelineStageFlagBits::eTopOfPipe, _timestamps.get(), index * 2);
+            if (_statistics) cmd.beginQuery(_statistics.get(), index, {});
+        }
+
+        void EndPass(vk::CommandBuffer cmd, uint32_t slot, uint32_t pass) {
+            if (!IsEnabled()) return;
+            const auto index = slot * static_cast<uint32_t>(_passes.size()) + pass;
+            if (_statistics) cmd.endQuery(_statistics.get(), index);
+            cmd.writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, _timestamps.get(), index * 2 + 1);
+        }
+
+        // Collects the frames still pending in their slots, once the device is idle
+        void Flush() {
+            if (!IsEnabled()) return;
+            std::vector<uint32_t> pending;
+            for (uint32_t i = 0; i < _slots.size(); ++i) if (_slots[i].Recorded) pending.push_back(i);
+            std::sort(pending.begin(), pending.end(), [this](uint32_t a, uint32_t b) {
+                return _slots[a].Frame < _slots[b].Frame;
+            });
+            for (auto slot : pending) {
+                Collect(slot, _slots[slot].Frame);
+                _slots[slot].Recorded = false;
+            }
+        }
+
+        // One line per pass over the rolling window
+        void Report(std::ostream& out) const {
+            for (size_t i = 0; i < _milliseconds.size(); ++i) {
+                const auto& ms = _milliseconds[i];
+                if (!ms.GetCount()) continue;
+                out << "gpu " << _passes[i] << ": min: " << ms.Min() << "ms, avg: " << ms.Average()
+                    << "ms, p99: " << ms.Percentile(0.99) << "ms";
+                if (_statistics) out << ", fragments: " << static_cast<uint64_t>(_invocations[i].Average());
+                out << std::endl;
+            }
+        }
+    private:
+        struct SlotState {
+            bool Recorded = false;
+            uint64_t Frame = 0;
+        };
+
+        void Collect(uint32_t slot, uint64_t frame) {
+            const auto count = static_cast<uint32_t>(_passes.size());
+            std::vector<uint64_t> timestamps(count * 2), invocations(count);
+            // The slot's fence has been waited on, so not ready only happens if a frame was never submitted
+            if (_device.getQueryPoolResults(_timestamps.get(), slot * count * 2, count * 2,
+                    timestamps.size() * sizeof(uint64_t), timestamps.data(), sizeof(uint64_t),
+                    vk::QueryResultFlagBits::e64) != vk::Result::eSuccess) return;
+            if (_statistics && _device.getQueryPoolResults(_statistics.get(), slot * count, count,
+                    invocations.size() * sizeof(uint64_t), invocations.data(), sizeof(uint64_t),
+                    vk::QueryResultFlagBits::e64) != vk::Result::eSuccess) return;
+            for (uint32_t i = 0; i < count; ++i) {
+                const auto ticks = (timestamps[i * 2 + 1] - timestamps[i * 2]) & _mask;
+                const auto ms = static_cast<double>(ticks) * _period / 1e6;
+                _milliseconds[i].Push(ms);
+                _invocations[i].Push(static_cast<double>(invocations[i]));
+                if (_csv) _csv << frame << ',' << _passes[i] << ',' << ms << ',' << invocations[i] << '\n';
+            }
+        }
+
+        vk::Device _device;
+        std::vector<std::string> _passes;
+        std::vector<SlotState> _slots;
+        float _period = 1.0f;
+        uint64_t _mask = ~0ull;
+        vk::UniqueQueryPool _timestamps;
+        vk::UniqueQueryPool _statistics;
+        std::vector<Utils::RollingStatistics> _milliseconds;
+        std::vector<Utils::RollingStatistics> _invocations;
+        std::ofstream _csv;
+    };
+}
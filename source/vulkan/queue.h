@@ -8,6 +8,27 @@
 #include <vulkan/vulkan.hpp>
 
 namespace Vulkan {
+    // The family every kind of work is submitted to. Compute and transfer fall back to the graphics family
+    // on devices without families of their own
+    struct QueueFamilies {
+        uint32_t Graphics{}, Present{}, Compute{}, Transfer{};
+
+        // One queue per distinct family. Graphics and present get the higher priority, async work must never
+        // starve the frame
+        std::vector<vk::DeviceQueueCreateInfo> GetCreateInfos() const {
+            static constexpr float FramePriority = 1.0f, AsyncPriority = 0.5f;
+            std::vector<vk::DeviceQueueCreateInfo> infos;
+            for (const auto family : {Graphics, Present, Compute, Transfer}) {
+                const auto exists = std::any_of(infos.begin(), infos.end(),
+                        [family](const auto& x) { return x.queueFamilyIndex == family; });
+                if (exists) continue;
+                const auto frame = family == Graphics || family == Present;
+                infos.emplace_back(vk::DeviceQueueCreateFlags(), family, 1, frame ? &FramePriority : &AsyncPriority);
+            }
+            return infos;
+        }
+    };
+
     class QueueProperty {
     public:
         explicit QueueProperty(
@@ -51,14 +72,53 @@ namespace Vulkan {
             return {GraphicsIndex, PresentIndex};
         }
 
+        // Graphics and present as above, compute and transfer on families of their own when the device has them
+        QueueFamilies GetFamilies(VkSurfaceKHR surface) {
+            GetGraphicsAndPresentFast(surface);
+            return MakeFamilies();
+        }
+
+        QueueFamilies GetHeadlessFamilies() {
+            PresentIndex = GetGraphicsFast();
+            return MakeFamilies();
+        }
+
+        size_t GetGraphicsFast() {
+            SelectFirstGraphicsQueueFamilyIndex();
+            if (GraphicsIndex==FamilyProperties.size()) {
+                throw std::runtime_error("Could not find a queue for graphics");
+            }
+            return GraphicsIndex;
+        }
+
         void SelectFirstGraphicsQueueFamilyIndex() {
-            GraphicsIndex = std::find_if(FamilyProperties.begin(), FamilyProperties.end(),
-                    [](const auto& qfp) { return qfp.CheckFlag(vk::QueueFlagBits::eGraphics); })->GetIndex();
+            const auto it = std::find_if(FamilyProperties.begin(), FamilyProperties.end(),
+                    [](const auto& qfp) { return qfp.CheckFlag(vk::QueueFlagBits::eGraphics); });
+            GraphicsIndex = it!=FamilyProperties.end() ? it->GetIndex() : FamilyProperties.size();
         }
 
-        void SelectFirstCmputeQueueFamilyIndex() {
-            ComputeIndex = std::find_if(FamilyProperties.begin(), FamilyProperties.end(),
-                    [](const auto& qfp) { return qfp.CheckFlag(vk::QueueFlagBits::eCompute); })->GetIndex();
+        // A compute family without graphics (async compute), otherwise the graphics family, which the spec
+        // guarantees can compute if the device has any graphics family at all
+        void SelectComputeQueueFamilyIndex() {
+            const auto it = std::find_if(FamilyProperties.begin(), FamilyProperties.end(), [](const auto& qfp) {
+                return qfp.CheckFlag(vk::QueueFlagBits::eCompute) && !qfp.CheckFlag(vk::QueueFlagBits::eGraphics);
+            });
+            ComputeIndex = it!=FamilyProperties.end() ? it->GetIndex() : GraphicsIndex;
+        }
+
+        // A transfer only family (the copy engines), else any family without graphics, else the graphics family.
+        // Graphics and compute families can always transfer, whether they report it or not
+        void SelectTransferQueueFamilyIndex() {
+            const auto dedicated = std::find_if(FamilyProperties.begin(), FamilyProperties.end(), [](const auto& qfp) {
+                return qfp.CheckFlag(vk::QueueFlagBits::eTransfer) &&
+                       !qfp.CheckFlag(vk::QueueFlagBits::eGraphics | vk::QueueFlagBits::eCompute);
+            });
+            const auto async = std::find_if(FamilyProperties.begin(), FamilyProperties.end(), [](const auto& qfp) {
+                return qfp.CheckFlag(vk::QueueFlagBits::eTransfer | vk::QueueFlagBits::eCompute) &&
+                       !qfp.CheckFlag(vk::QueueFlagBits::eGraphics);
+            });
+            TransferIndex = dedicated!=FamilyProperties.end() ? dedicated->GetIndex()
+                    : async!=FamilyProperties.end() ? async->GetIndex() : GraphicsIndex;
         }
 
         void FindPresentQueue(VkSurfaceKHR surface) {
@@ -103,8 +163,15 @@ namespace Vulkan {
             }
         }
     private:
+        QueueFamilies MakeFamilies() {
+            SelectComputeQueueFamilyIndex();
+            SelectTransferQueueFamilyIndex();
+            return {static_cast<uint32_t>(GraphicsIndex), static_cast<uint32_t>(PresentIndex),
+                    static_cast<uint32_t>(ComputeIndex), static_cast<uint32_t>(TransferIndex)};
+        }
+
         vk::PhysicalDevice Device;
-        size_t GraphicsIndex{}, PresentIndex{}, ComputeIndex{};
+        size_t GraphicsIndex{}, PresentIndex{}, ComputeIndex{}, TransferIndex{};
         const std::vector<QueueProperty> FamilyProperties;
     };
 }
\ No newline at end of file
@@ -0,0 +1,334 @@
+#include "reflection.h"
+#include <map>
+#include <algorithm>
+#include <unordered_map>
+
+namespace Vulkan {
+    namespace {
+        // The subset of the SPIR-V specification reflection needs
+        constexpr uint32_t SpirvMagic = 0x07230203u;
+        constexpr size_t HeaderWords = 5;
+
+        enum Op : uint32_t {
+            OpName = 5, OpTypeBool = 20, OpTypeInt = 21, OpTypeFloat = 22, OpTypeVector = 23, OpTypeMatrix = 24,
+            OpTypeImage = 25, OpTypeSampler = 26, OpTypeSampledImage = 27, OpTypeArray = 28,
+            OpTypeRuntimeArray = 29, OpTypeStruct = 30, OpTypePointer = 32, OpConstant = 43, OpVariable = 59,
+            OpDecorate = 71, OpMemberDecorate = 72
+        };
+
+        enum Decoration : uint32_t {
+            Block = 2, BufferBlock = 3, ArrayStride = 6, MatrixStride = 7, Binding = 33, DescriptorSet = 34,
+            Offset = 35
+        };
+
+        enum StorageClass : uint32_t {
+            UniformConstant = 0, Uniform = 2, PushConstant = 9, StorageBuffer = 12
+        };
+
+        enum Dim : uint32_t { DimBuffer = 5, DimSubpassData = 6 };
+
+        struct Type {
+            uint32_t Op{};
+            std::vector<uint32_t> Operands; // Everything after the result id
+        };
+
+        struct Decorations {
+            std::unordered_map<uint32_t, uint32_t> Values;
+            std::map<uint32_t, std::unordered_map<uint32_t, uint32_t>> Members;
+        };
+
+        class Module {
+        public:
+            explicit Module(const std::vector<unsigned int>& spv) {
+                if (spv.size() < HeaderWords || spv[0] != SpirvMagic) throw ShaderLayout::MalformedSpirv();
+                for (size_t i = HeaderWords; i < spv.size();) {
+                    const uint32_t count = spv[i] >> 16u, op = spv[i] & 0xffffu;
+                    if (count == 0 || i + count > spv.size()) throw ShaderLayout::MalformedSpirv();
+                    Parse(op, &spv[i + 1], count - 1);
+                    i += count;
+                }
+            }
+
+            void Reflect(vk::ShaderStageFlagBits stage, std::vector<ShaderBinding>& bindings,
+                    std::vector<vk::PushConstantRange>& pushConstants) const {
+                for (auto [id, pointer] : _variables) {
+                    const auto& pointerType = Get(pointer);
+                    if (pointerType.Op != OpTypePointer || pointerType.Operands.size() < 2) continue;
+                    const auto storage = pointerType.Operands[0];
+                    if (storage == PushConstant) {
+                        const auto [begin, end] = GetRange(pointerType.Operands[1]);
+                        pushConstants.emplace_back(stage, begin, end - begin);
+                        continue;
+                    }
+                    if (storage != UniformConstant && storage != Uniform && storage != StorageBuffer) continue;
+                    ShaderBinding binding;
+                    binding.Set = GetDecoration(id, DescriptorSet);
+                    binding.Binding = GetDecoration(id, Binding);
+                    binding.Stages = stage;
+                    auto type = pointerType.Operands[1];
+                    // Arrays of descriptors
+                    while (Get(type).Op == OpTypeArray || Get(type).Op == OpTypeRuntimeArray) {
+                        if (Get(type).Op == OpTypeArray) binding.Count *= GetConstant(Get(type).Operands.at(1));
+                        type = Get(type).Operands.at(0);
+                    }
+                    if (!GetType(storage, type, binding.Type)) continue;
+                    binding.Name = GetName(id);
+                    if (binding.Name.empty()) binding.Name = GetName(type);
+                    bindings.push_back(std::move(binding));
+                }
+            }
+        private:
+            void Parse(uint32_t op, const uint32_t* operands, uint32_t count) {
+                switch (op) {
+                case OpName:
+                    if (count >= 2) _names[operands[0]] = ReadString(operands + 1, count - 1);
+                    break;
+                case OpDecorate:
+                    if (count >= 2) _decorations[operands[0]].Values[operands[1]] = count >= 3 ? operands[2] : 1;
+                    break;
+                case OpMemberDecorate:
+                    if (count >= 3) {
+                        _decorations[operands[0]].Members[operands[1]][operands[2]] = count >= 4 ? operands[3] : 1;
+                    }
+                    break;
+                case OpConstant:
+                    if (count >= 3) _constants[operands[1]] = operands[2];
+                    break;
+                case OpVariable:
+                    if (count >= 3) _variables.emplace_back(operands[1], operands[0]);
+                    break;
+                case OpTypeBool: case OpTypeInt: case OpTypeFloat: case OpTypeVector: case OpTypeMatrix:
+                case OpTypeImage: case OpTypeSampler: case OpTypeSampledImage: case OpTypeArray:
+                case OpTypeRuntimeArray: case OpTypeStruct: case OpTypePointer:
+                    if (count >= 1) _types[operands[0]] = {op, std::vector<uint32_t>(operands + 1, operands + count)};
+                    break;
+                default:
+                    break;
+                }
+            }
+
+            static std::string ReadString(const uint32_t* words, uint32_t count) {
+                std::string text;
+                for (uint32_t i = 0; i < count * 4; ++i) {
+                    const auto c = static_cast<char>((words[i / 4] >> (8u * (i % 4))) & 0xffu);
+                    if (c == '\0') break;
+                    text.push_back(c);
+                }
+                return text;
+            }
+
+            const Type& Get(uint32_t id) const {
+                const auto found = _types.find(id);
+                if (found == _types.end()) throw ShaderLayout::MalformedSpirv();
+                return found->second;
+            }
+
+            std::string GetName(uint32_t id) const {
+                const auto found = _names.find(id);
+                return found == _names.end() ? std::string() : found->second;
+            }
+
+            uint32_t GetConstant(uint32_t id) const {
+                const auto found = _constants.find(id);
+                if (found == _constants.end()) throw ShaderLayout::MalformedSpirv();
+                return found->second;
+            }
+
+            uint32_t GetDecoration(uint32_t id, uint32_t decoration, uint32_t fallback = 0) const {
+                const auto found = _decorations.find(id);
+                if (found == _decorations.end()) return fallback;
+                const auto value = found->second.Values.find(decoration);
+                return value == found->second.Values.end() ? fallback : value->second;
+            }
+
+            bool HasDecoration(uint32_t id, uint32_t decoration) const {
+                const auto found = _decorations.find(id);
+                return found != _decorations.end() && found->second.Values.count(decoration);
+            }
+
+            uint32_t GetMemberDecoration(uint32_t id, uint32_t member, uint32_t decoration) const {
+                const auto found = _decorations.find(id);
+                if (found == _decorations.end()) return 0;
+                const auto members = found->second.Members.find(member);
+                if (members == found->second.Members.end()) return 0;
+                const auto value = members->second.find(decoration);
+                return value == members->second.end() ? 0 : value->second;
+            }
+
+            bool GetType(uint32_t storage, uint32_t id, vk::DescriptorType& out) const {
+                const auto& type = Get(id);
+                switch (type.Op) {
+                case OpTypeSampledImage:
+                    out = vk::DescriptorType::eCombinedImageSampler;
+                    return true;
+                case OpTypeSampler:
+                    out = vk::DescriptorType::eSampler;
+                    return true;
+                case OpTypeImage: {
+                    // Sampled type, Dim, Depth, Arrayed, MS, Sampled, Format
+                    const auto dim = type.Operands.at(1);
+                    const bool storageImage = type.Operands.at(5) == 2;
+                    if (dim == DimSubpassData) out = vk::DescriptorType::eInputAttachment;
+                    else if (dim == DimBuffer) {
+                        out = storageImage ? vk::DescriptorType::eStorageTexelBuffer
+                                : vk::DescriptorType::eUniformTexelBuffer;
+                    }
+                    else out = storageImage ? vk::DescriptorType::eStorageImage : vk::DescriptorType::eSampledImage;
+                    return true;
+                }
+                case OpTypeStruct:
+                    // Before SPIR-V 1.3 storage buffers are Uniform blocks decorated BufferBlock
+                    if (storage == StorageBuffer || HasDecoration(id, BufferBlock)) {
+                        out = vk::DescriptorType::eStorageBuffer;
+                        return true;
+                    }
+                    if (storage == Uniform && HasDecoration(id, Block)) {
+                        out = vk::DescriptorType::eUniformBuffer;
+                        return true;
+                    }
+                    return false;
+                default:
+                    return false;
+                }
+            }
+
+            // In bytes, following the explicit layout decorations of the block
+            uint32_t GetSize(uint32_t id, uint32_t matrixStride = 0) const {
+                const auto& type = Get(id);
+                switch (type.Op) {
+                case OpTypeBool:
+                    return 4;
+                case OpTypeInt:
+                case OpTypeFloat:
+                    return type.Operands.at(0) / 8;
+                case OpTypeVector:
+                    return type.Operands.at(1) * GetSize(type.Operands.at(0));
+                case OpTypeMatrix:
+                    return type.Operands.at(1) * (matrixStride ? matrixStride : GetSize(type.Operands.at(0)));
+                case OpTypeArray: {
+                    const auto stride = GetDecoration(id, ArrayStride);
+                    const auto length = GetConstant(type.Operands.at(1));
+                    return length * (stride ? stride : GetSize(type.Operands.at(0), matrixStride));
+                }
+                case OpTypeStruct: {
+                    const auto range = GetRange(id);
+                    return range.second;
+                }
+                default:
+                    return 0; // Runtime arrays and opaque types take no room of their own
+                }
+            }
+
+            // First and one past the last byte the members of a block cover
+            std::pair<uint32_t, uint32_t> GetRange(uint32_t id) const {
+                const auto& type = Get(id);
+                if (type.Op != OpTypeStruct || type.Operands.empty()) return {0, 0};
+                uint32_t begin = ~0u, end = 0;
+                for (uint32_t member = 0; member < type.Operands.size(); ++member) {
+                    const auto offset = GetMemberDecoration(id, member, Offset);
+                    const auto size = GetSize(type.Operands[member], GetMemberDecoration(id, member, MatrixStride));
+                    begin = std::min(begin, offset);
+                    end = std::max(end, offset + size);
+                }
+                return {begin, end};
+            }
+
+            std::unordered_map<uint32_t, std::string> _names;
+            std::unordered_map<uint32_t, Decorations> _decorations;
+            std::unordered_map<uint32_t, Type> _types;
+            std::unordered_map<uint32_t, uint32_t> _constants;
+            std::vector<std::pair<uint32_t, uint32_t>> _variables; // Result id and pointer type
+        };
+    }
+
+    ShaderLayout& ShaderLayout::Add(const std::vector<unsigned int>& spv, vk::ShaderStageFlagBits stage) {
+        std::vector<ShaderBinding> bindings;
+        std::vector<vk::PushConstantRange> pushConstants;
+        Module(spv).Reflect(stage, bindings, pushConstants);
+        for (auto& binding : bindings) {
+            const auto same = std::find_if(_bindings.begin(), _bindings.end(), [&binding](const ShaderBinding& x) {
+                return x.Set == binding.Set && x.Binding == binding.Binding;
+            });
+            if (same == _bindings.end()) {
+                _bindings.push_back(std::move(binding));
+                continue;
+            }
+            if (same->Type != binding.Type || same->Count != binding.Count) throw BindingMismatch();
+            same->Stages |= binding.Stages;
+        }
+        // Stages may share a range only when they declare the same block
+        for (auto& range : pushConstants) {
+            const auto same = std::find_if(_pushConstants.begin(), _pushConstants.end(),
+                    [&range](const vk::PushConstantRange& x) {
+                        return x.offset == range.offset && x.size == range.size;
+                    });
+            if (same == _pushConstants.end()) _pushConstants.push_back(range);
+            else same->stageFlags |= range.stageFlags;
+        }
+        std::sort(_bindings.begin(), _bindings.end(), [](const ShaderBinding& a, const ShaderBinding& b) {
+            return std::make_pair(a.Set, a.Binding) < std::make_pair(b.Set, b.Binding);
+        });
+        return *this;
+    }
+
+    ShaderLayout& ShaderLayout::MakeDynamic(const std::string& name) {
+        const auto found = std::find_if(_bindings.begin(), _bindings.end(),
+                [&name](const ShaderBinding& x) { return x.Name == name; });
+        if (found == _bindings.end()) throw UnknownBinding();
+        auto& binding = *found;
+        if (binding.Type == vk::DescriptorType::eUniformBuffer) {
+            binding.Type = vk::DescriptorType::eUniformBufferDynamic;
+        }
+        else if (binding.Type == vk::DescriptorType::eStorageBuffer) {
+            binding.Type = vk::DescriptorType::eStorageBufferDynamic;
+        }
+        return *this;
+    }
+
+    const ShaderBinding& ShaderLayout::Find(const std::string& name) const {
+        const auto found = std::find_if(_bindings.begin(), _bindings.end(),
+                [&name](const ShaderBinding& x) { return x.Name == name; });
+        if (found == _bindings.end()) throw UnknownBinding();
+        return *found;
+    }
+
+    bool ShaderLayout::IsCompatible(const ShaderLayout& other) const noexcept {
+        const auto sameBinding = [](const ShaderBinding& a, const ShaderBinding& b) {
+            return a.Set == b.Set && a.Binding == b.Binding && a.Type == b.Type && a.Count == b.Count &&
+                   a.Stages == b.Stages;
+        };
+        const auto sameRange = [](const vk::PushConstantRange& a, const vk::PushConstantRange& b) {
+            return a.stageFlags == b.stageFlags && a.offset == b.offset && a.size == b.size;
+        };
+        return std::equal(_bindings.begin(), _bindings.end(), other._bindings.begin(), other._bindings.end(),
+                sameBinding) && std::equal(_pushConstants.begin(), _pushConstants.end(),
+                other._pushConstants.begin(), other._pushConstants.end(), sameRange);
+    }
+
+    std::vector<vk::DescriptorPoolSize> ShaderLayout::GetPoolSizes(uint32_t set) const {
+        std::vector<vk::DescriptorPoolSize> sizes;
+        for (auto& binding : _bindings) {
+            if (binding.Set != set) continue;
+            const auto same = std::find_if(sizes.begin(), sizes.end(),
+                    [&binding](const vk::DescriptorPoolSize& x) { return x.type == binding.Type; });
+            if (same == sizes.end()) sizes.emplace_back(binding.Type, binding.Count);
+            else same->descriptorCount += binding.Count;
+        }
+        return sizes;
+    }
+
+    vk::UniqueDescriptorSetLayout ShaderLayout::CreateSetLayout(vk::Device device, uint32_t set) const {
+        std::vector<vk::DescriptorSetLayoutBinding> bindings;
+        for (auto& binding : _bindings) {
+            if (binding.Set == set) bindings.emplace_back(binding.Binding, binding.Type, binding.Count, binding.Stages);
+        }
+        return device.createDescriptorSetLayoutUnique(vk::DescriptorSetLayoutCreateInfo({},
+                static_cast<uint32_t>(bindings.size()), bindings.data()));
+    }
+
+    vk::UniquePipelineLayout ShaderLayout::CreatePipelineLayout(vk::Device device,
+            vk::DescriptorSetLayout setLayout) const {
+        return device.createPipelineLayoutUnique(vk::PipelineLayoutCreateInfo({}, 1, &setLayout,
+                static_cast<uint32_t>(_pushConstants.size()), _pushConstants.data()));
+    }
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+#include "../util/exceptions.h"
+
+namespace Vulkan {
+    struct ShaderBinding {
+        std::string Name; // Of the variable, or of the block for anonymous uniform and storage blocks
+        uint32_t Set{};
+        uint32_t Binding{};
+        vk::DescriptorType Type{};
+        uint32_t Count = 1;
+        vk::ShaderStageFlags Stages;
+    };
+
+    // The descriptors and push constants a set of shader stages declares, read back from their SPIR-V so the
+    // layouts always match the shaders. Works on cached modules as well as fresh compiles
+    class ShaderLayout {
+    public:
+        VXRT_EXCEPTION(MalformedSpirv, "Malformed SPIR-V")
+        VXRT_EXCEPTION(BindingMismatch, "Stages Declare Different Resources At The Same Binding")
+        VXRT_EXCEPTION(UnknownBinding, "No Such Binding In The Shader Layout")
+
+        // Merges in everything `stage` declares
+        ShaderLayout& Add(const std::vector<unsigned int>& spv, vk::ShaderStageFlagBits stage);
+
+        // SPIR-V can not tell a dynamic uniform or storage buffer from a static one
+        ShaderLayout& MakeDynamic(const std::string& name);
+
+        const ShaderBinding& Find(const std::string& name) const;
+
+        const std::vector<ShaderBinding>& GetBindings() const noexcept { return _bindings; }
+
+        const std::vector<vk::PushConstantRange>& GetPushConstants() const noexcept { return _pushConstants; }
+
+        // Same bindings and push constants, so pipelines of either can share set and pipeline layouts
+        bool IsCompatible(const ShaderLayout& other) const noexcept;
+
+        // What one descriptor set of the given set number takes out of a pool
+        std::vector<vk::DescriptorPoolSize> GetPoolSizes(uint32_t set = 0) const;
+
+        vk::UniqueDescriptorSetLayout CreateSetLayout(vk::Device device, uint32_t set = 0) const;
+
+        vk::UniquePipelineLayout CreatePipelineLayout(vk::Device device, vk::DescriptorSetLayout setLayout) const;
+    private:
+        std::vector<ShaderBinding> _bindings;
+        std::vector<vk::PushConstantRange> _pushConstants;
+    };
+}
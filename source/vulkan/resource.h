@@ -0,0 +1,61 @@
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+#include "allocator.h"
+
+namespace Vulkan {
+    // Members are ordered so that the view and the handle go away before the memory backing them
+    struct Image {
+        Allocation Memory;
+        vk::UniqueImage Handle;
+        vk::UniqueImageView View;
+        vk::Format Format{};
+        vk::Extent2D Extent{};
+        uint32_t MipLevels{};
+    };
+
+    struct Buffer {
+        Allocation Memory;
+        vk::UniqueBuffer Handle;
+        vk::DeviceSize Size{};
+        void* Mapped{};
+    };
+
+    class Resources {
+    public:
+        static Image CreateImage2D(Allocator& allocator, vk::Device device, vk::Format format,
+                vk::Extent2D extent, uint32_t mipLevels, vk::ImageUsageFlags usage) {
+            Image image;
+            image.Format = format;
+            image.Extent = extent;
+            image.MipLevels = mipLevels;
+            image.Handle = device.createImageUnique(vk::ImageCreateInfo(
+                    {}, vk::ImageType::e2D, format, vk::Extent3D(extent.width, extent.height, 1), mipLevels, 1,
+                    vk::SampleCountFlagBits::e1, vk::ImageTiling::eOptimal, usage, vk::SharingMode::eExclusive,
+                    0, nullptr, vk::ImageLayout::eUndefined
+            ));
+            const auto requirements = device.getImageMemoryRequirements(image.Handle.get());
+            image.Memory = allocator.Allocate(requirements, vk::MemoryPropertyFlagBits::eDeviceLocal,
+                    Allocator::Tiling::Optimal);
+            device.bindImageMemory(image.Handle.get(), image.Memory.GetMemory(), image.Memory.GetOffset());
+            image.View = device.createImageViewUnique(vk::ImageViewCreateInfo(
+                    {}, image.Handle.get(), vk::ImageViewType::e2D, format, vk::ComponentMapping(),
+                    vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, mipLevels, 0, 1)
+            ));
+            return image;
+        }
+
+        // Host visible buffers point into their block's mapping, which stays mapped until the allocator goes
+        static Buffer CreateBuffer(Allocator& allocator, vk::Device device, vk::DeviceSize size,
+                vk::BufferUsageFlags usage, vk::MemoryPropertyFlags flags) {
+            Buffer buffer;
+            buffer.Size = size;
+            buffer.Handle = device.createBufferUnique(vk::BufferCreateInfo({}, size, usage, vk::SharingMode::eExclusive));
+            const auto requirements = device.getBufferMemoryRequirements(buffer.Handle.get());
+            buffer.Memory = allocator.Allocate(requirements, flags, Allocator::Tiling::Linear);
+            device.bindBufferMemory(buffer.Handle.get(), buffer.Memory.GetMemory(), buffer.Memory.GetOffset());
+            buffer.Mapped = buffer.Memory.GetMapped();
+            return buffer;
+        }
+    };
+}
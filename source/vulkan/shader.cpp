@@ -1,9 +1,29 @@
 #include "shader.h"
+#include <cstring>
 #include <SPIRV/GlslangToSpv.h>
 #include <StandAlone/ResourceLimits.h>
+#include "../util/hash.h"
+#include "../util/cache.h"
 
 namespace Vulkan {
     namespace { ;
+        // Enable SPIR-V and Vulkan rules when parsing GLSL
+        constexpr auto CompileMessages = (EShMessages) (EShMsgSpvRules | EShMsgVulkanRules);
+        constexpr int CompileDefaultVersion = 100;
+
+        // Bump when the entry layout or anything else feeding the compile changes
+        constexpr uint32_t CacheMagic = 0x50535856u; // "VXSP"
+        constexpr uint32_t CacheVersion = 1u;
+        constexpr uint32_t SpirvMagic = 0x07230203u;
+
+        struct CacheHeader {
+            uint32_t Magic;
+            uint32_t Version;
+            uint64_t Key;
+            uint64_t PayloadHash;
+            uint64_t PayloadWords;
+        };
+
         EShLanguage translateShaderStage(vk::ShaderStageFlagBits stage) {
             switch (stage) {
             case vk::ShaderStageFlagBits::eVertex: return EShLangVertex;
@@ -23,12 +43,69 @@ namespace Vulkan {
             default: throw Compiler::UnknownShaderStageException();
             }
         }
+
+        uint64_t CacheKey(vk::ShaderStageFlagBits type, const std::string& source) {
+            std::string spirvVersion;
+            glslang::GetSpirvVersion(spirvVersion);
+            return Utils::Hasher()
+                    .Add(CacheVersion)
+                    .Add(static_cast<uint32_t>(type))
+                    .Add(static_cast<int>(CompileMessages))
+                    .Add(CompileDefaultVersion)
+                    .Add(glslang::GetGlslVersionString())
+                    .Add(glslang::GetSpirvGeneratorVersion())
+                    .Add(spirvVersion)
+                    .Add(source)
+                    .Get();
+        }
+
+        uint64_t PayloadHash(const unsigned int* words, size_t count) {
+            return Utils::Hasher().Add(words, count * sizeof(unsigned int)).Get();
+        }
+
+        std::vector<unsigned int> LoadCached(const Utils::DiskCache& cache, const std::string& name, uint64_t key) {
+            const auto blob = cache.Load(name);
+            if (!blob || blob->size() < sizeof(CacheHeader)) return {};
+            CacheHeader header{};
+            std::memcpy(&header, blob->data(), sizeof(header));
+            const auto payloadSize = blob->size() - sizeof(CacheHeader);
+            if (header.Magic != CacheMagic || header.Version != CacheVersion || header.Key != key ||
+                header.PayloadWords == 0 || payloadSize != header.PayloadWords * sizeof(unsigned int)) {
+                return {};
+            }
+            std::vector<unsigned int> spv(header.PayloadWords);
+            std::memcpy(spv.data(), blob->data() + sizeof(CacheHeader), payloadSize);
+            if (spv[0] != SpirvMagic || PayloadHash(spv.data(), spv.size()) != header.PayloadHash) return {};
+            return spv;
+        }
+
+        void StoreCached(const Utils::DiskCache& cache, const std::string& name, uint64_t key,
+                const std::vector<unsigned int>& spv) {
+            const CacheHeader header{CacheMagic, CacheVersion, key, PayloadHash(spv.data(), spv.size()), spv.size()};
+            std::vector<char> blob(sizeof(header) + spv.size() * sizeof(unsigned int));
+            std::memcpy(blob.data(), &header, sizeof(header));
+            std::memcpy(blob.data() + sizeof(header), spv.data(), spv.size() * sizeof(unsigned int));
+            cache.Store(name, blob.data(), blob.size());
+        }
     }
 
-    void Compiler::Load() {
+    Compiler::ProcessContext::ProcessContext() {
         glslang::InitializeProcess();
     }
 
+    Compiler::ProcessContext::~ProcessContext() {
+        glslang::FinalizeProcess();
+    }
+
+    Compiler& Compiler::Instance() {
+        static Compiler instance;
+        return instance;
+    }
+
+    std::future<std::vector<unsigned int>> Compiler::CompileAsync(vk::ShaderStageFlagBits type, std::string source) {
+        return _workers.Submit([type, source = std::move(source)]() { return Compile(type, source); });
+    }
+
     std::vector<unsigned int> Compiler::CompileGlslang(const vk::ShaderStageFlagBits type, const std::string& source) {
         std::vector<unsigned int> spvShader;
         EShLanguage stage = translateShaderStage(type);
@@ -36,9 +113,8 @@ namespace Vulkan {
         const char* shaderStrings[1] = {source.data()};
         glslang::TShader shader(stage);
         shader.setStrings(shaderStrings, 1);
-        // Enable SPIR-V and Vulkan rules when parsing GLSL
-        auto messages = (EShMessages) (EShMsgSpvRules | EShMsgVulkanRules);
-        if (!shader.parse(&glslang::DefaultTBuiltInResource, 100, false, messages)) {
+        auto messages = CompileMessages;
+        if (!shader.parse(&glslang::DefaultTBuiltInResource, CompileDefaultVersion, false, messages)) {
             throw Compiler::GlslangCompileFailure(shader);
         }
 
@@ -51,16 +127,24 @@ namespace Vulkan {
         return spvShader;
     }
 
-    vk::UniqueShaderModule Compiler::CreateModule(vk::UniqueDevice& device, const std::vector<unsigned int>& spv) {
-        return device->createShaderModuleUnique(
+    std::vector<unsigned int> Compiler::Compile(const vk::ShaderStageFlagBits type, const std::string& source) {
+        static const Utils::DiskCache cache("spirv");
+        const auto key = CacheKey(type, source);
+        const auto name = Utils::Hasher::ToHex(key) + ".spv";
+        if (auto spv = LoadCached(cache, name, key); !spv.empty()) {
+            return spv;
+        }
+        auto spv = CompileGlslang(type, source);
+        StoreCached(cache, name, key, spv);
+        return spv;
+    }
+
+    vk::UniqueShaderModule Compiler::CreateModule(vk::Device device, const std::vector<unsigned int>& spv) {
+        return device.createShaderModuleUnique(
                 vk::ShaderModuleCreateInfo(
                         vk::ShaderModuleCreateFlags(),
                         spv.size()*sizeof(unsigned int), spv.data()
                 )
         );
     }
-
-    void Compiler::Unload() {
-        glslang::FinalizeProcess();
-    }
 }
\ No newline at end of file
@@ -1,7 +1,9 @@
 #pragma once
 
+#include <future>
 #include <vulkan/vulkan.hpp>
 #include "../util/exceptions.h"
+#include "../util/thread_pool.h"
 
 namespace Vulkan {
     class Compiler {
@@ -33,12 +35,36 @@ namespace Vulkan {
 
         VXRT_EXCEPTION(UnknownShaderStageException, "Unknown Shader Stage")
 
-        static void Load();
+        Compiler(const Compiler&) = delete;
 
+        Compiler& operator=(const Compiler&) = delete;
+
+        // The process wide compiler. glslang's process state is set up once on first use and torn down at exit,
+        // after the workers are joined
+        static Compiler& Instance();
+
+        // Compiles on a worker thread through the SPIR-V cache. Compile and link failures are rethrown by get()
+        std::future<std::vector<unsigned int>> CompileAsync(vk::ShaderStageFlagBits type, std::string source);
+
+        // The synchronous entry points expect Instance() to have been called, glslang is unusable before that
         static std::vector<unsigned int> CompileGlslang(vk::ShaderStageFlagBits type, const std::string& source);
 
-        static vk::UniqueShaderModule CreateModule(vk::UniqueDevice& device, const std::vector<unsigned int>& spv);
+        // CompileGlslang behind a content addressed on-disk cache keyed by the source, the stage, the glslang
+        // version and the compile flags. A missing, stale or corrupted entry falls back to a normal compile
+        static std::vector<unsigned int> Compile(vk::ShaderStageFlagBits type, const std::string& source);
+
+        static vk::UniqueShaderModule CreateModule(vk::Device device, const std::vector<unsigned int>& spv);
+    private:
+        struct ProcessContext {
+            ProcessContext();
+
+            ~ProcessContext();
+        };
+
+        Compiler() = default;
 
-        static void Unload();
+        // Declared first so the workers are gone before glslang is finalized
+        ProcessContext _context;
+        Utils::ThreadPool _workers;
     };
 }
\ No newline at end of file
@@ -0,0 +1,330 @@
+#pragma once
+
+#include <deque>
+#include <vector>
+#include <limits>
+#include <cstring>
+#include <cstdint>
+#include <optional>
+#include <algorithm>
+#include <vulkan/vulkan.hpp>
+#include "allocator.h"
+#include "command.h"
+#include "../util/exceptions.h"
+
+namespace Vulkan {
+    // Streams buffer and image contents to the device through one persistently mapped staging ring, on its own
+    // queue. Uploads are split into chunks and recorded into batches, a batch is submitted once it is flushed or
+    // the ring runs out of room. Nothing but the ring is ever allocated: a full ring waits for the oldest batch
+    // to retire, which is the only time the caller blocks.
+    // Every batch signals a timeline semaphore with its ticket. Acquire records the acquire half (QueueTransfer)
+    // of everything flushed so far into a consumer command buffer and returns the hand-off its submission waits
+    // on, so uploads reach the consumer without the host ever seeing them finish. Devices without timeline
+    // semaphores fall back to a fence per batch: only batches a Poll saw retire are acquired, and the consumer
+    // needs no semaphore. Not thread safe, meant to be driven by the render thread
+    class Uploader {
+    public:
+        VXRT_EXCEPTION(ChunkTooLarge, "Upload Chunk Does Not Fit The Staging Ring")
+
+        static constexpr vk::DeviceSize DefaultCapacity = vk::DeviceSize(16) << 20u;
+        static constexpr uint32_t DefaultBatches = 4;
+
+        // Who reads the uploads, and from when on
+        struct Consumer {
+            uint32_t Family;
+            vk::AccessFlags Access;
+            vk::PipelineStageFlags Stage;
+        };
+
+        // Tightly packed rows of one mip level
+        struct MipData {
+            uint32_t Level;
+            vk::Extent2D Extent;
+            const void* Data;
+        };
+
+        // `timeline` when the device enabled the timelineSemaphore feature
+        Uploader(vk::PhysicalDevice physical, vk::Device device, Allocator& allocator, vk::Queue queue,
+                uint32_t family, Consumer consumer, bool timeline, vk::DeviceSize capacity = DefaultCapacity,
+                uint32_t batches = DefaultBatches)
+                :_device(device), _queue(queue), _family(family), _consumer(consumer) {
+            _granularity = physical.getQueueFamilyProperties()[family].minImageTransferGranularity;
+            _capacity = capacity;
+            _staging = device.createBufferUnique(vk::BufferCreateInfo({}, _capacity,
+                    vk::BufferUsageFlagBits::eTransferSrc, vk::SharingMode::eExclusive));
+            _memory = allocator.Allocate(device.getBufferMemoryRequirements(_staging.get()),
+                    vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
+                    Allocator::Tiling::Linear);
+            device.bindBufferMemory(_staging.get(), _memory.GetMemory(), _memory.GetOffset());
+            _mapped = static_cast<char*>(_memory.GetMapped());
+            _pool = device.createCommandPoolUnique(vk::CommandPoolCreateInfo(
+                    vk::CommandPoolCreateFlagBits::eTransient | vk::CommandPoolCreateFlagBits::eResetCommandBuffer,
+                    family));
+            auto buffers = device.allocateCommandBuffersUnique(vk::CommandBufferAllocateInfo(_pool.get(),
+                    vk::CommandBufferLevel::ePrimary, std::max(batches, 2u)));
+            if (timeline) {
+                const vk::StructureChain<vk::SemaphoreCreateInfo, vk::SemaphoreTypeCreateInfo> info({},
+                        {vk::SemaphoreType::eTimeline, 0});
+                _timeline = device.createSemaphoreUnique(info.get<vk::SemaphoreCreateInfo>());
+            }
+            for (auto& x : buffers) {
+                auto& batch = _batches.emplace_back();
+                batch.Commands = std::move(x);
+                if (!timeline) batch.Fence = device.createFenceUnique({});
+            }
+        }
+
+        Uploader(const Uploader&) = delete;
+
+        Uploader& operator=(const Uploader&) = delete;
+
+        ~Uploader() {
+            while (!_inFlight.empty()) Retire(true);
+        }
+
+        // Returns the ticket of the batch holding the last chunk, see IsDone
+        uint64_t Buffer(vk::Buffer target, vk::DeviceSize offset, const void* data, vk::DeviceSize size) {
+            const auto bytes = static_cast<const char*>(data);
+            for (vk::DeviceSize done = 0; done < size;) {
+                const auto chunk = std::min(size - done, GetMaxChunk());
+                const auto staged = Stage(bytes + done, chunk);
+                Current().Commands->copyBuffer(_staging.get(), target, vk::BufferCopy(staged, offset + done, chunk));
+                done += chunk;
+            }
+            Current().Handovers.push_back({target});
+            return _submitted + 1;
+        }
+
+        // Fills the listed mips of an image nothing has written yet and leaves it in `layout`. A mip is copied in
+        // bands of rows as small as the queue's transfer granularity allows
+        uint64_t Image(vk::Image target, uint32_t mipLevels, vk::DeviceSize texelSize,
+                const std::vector<MipData>& mips, vk::ImageLayout layout) {
+            // Later chunks may land in later batches, queue submission order keeps them after the transition
+            Commands::TransitionImage(Current().Commands.get(), target, mipLevels, vk::ImageLayout::eUndefined,
+                    vk::ImageLayout::eTransferDstOptimal, {}, vk::AccessFlagBits::eTransferWrite,
+                    vk::PipelineStageFlagBits::eTopOfPipe, vk::PipelineStageFlagBits::eTransfer);
+            for (const auto& mip : mips) {
+                const auto rowBytes = mip.Extent.width * texelSize;
+                const auto rows = GetRowsPerChunk(mip.Extent, rowBytes);
+                for (uint32_t y = 0; y < mip.Extent.height; y += rows) {
+                    const auto band = std::min(rows, mip.Extent.height - y);
+                    const auto staged = Stage(static_cast<const char*>(mip.Data) + y * rowBytes, band * rowBytes);
+                    Current().Commands->copyBufferToImage(_staging.get(), target,
+                            vk::ImageLayout::eTransferDstOptimal, vk::BufferImageCopy(staged, 0, 0,
+                                    vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, mip.Level, 0, 1),
+                                    vk::Offset3D(0, static_cast<int32_t>(y), 0),
+                                    vk::Extent3D(mip.Extent.width, band, 1)));
+                }
+            }
+            Current().Handovers.push_back({{}, target, mipLevels, layout});
+            return _submitted + 1;
+        }
+
+        // Submits what was recorded so far. Returns its ticket, or that of the last submission when empty
+        uint64_t Flush() {
+            auto& batch = _batches[_current];
+            if (!batch.Recording) return _submitted;
+            // The release half, the acquire half is recorded by Acquire
+            const QueueTransfer handover(_family, _consumer.Family);
+            for (const auto& x : batch.Handovers) {
+                if (x.Image) {
+                    handover.ReleaseImage(batch.Commands.get(), x.Image, x.MipLevels,
+                            vk::ImageLayout::eTransferDstOptimal, x.Layout, vk::AccessFlagBits::eTransferWrite,
+                            vk::PipelineStageFlagBits::eTransfer);
+                }
+                else {
+                    handover.ReleaseBuffer(batch.Commands.get(), x.Buffer, vk::AccessFlagBits::eTransferWrite,
+                            vk::PipelineStageFlagBits::eTransfer);
+                }
+            }
+            batch.Commands->end();
+            batch.Recording = false;
+            batch.Ticket = ++_submitted;
+            batch.RingEnd = _head;
+            if (_timeline) {
+                // The consumer can acquire at once, its submission waits for the ticket on the device
+                _acquire.insert(_acquire.end(), batch.Handovers.begin(), batch.Handovers.end());
+                _acquireTicket = batch.Ticket;
+                batch.Handovers.clear();
+                Commands::Submit(_queue, batch.Commands.get(), {{nullptr, {}, _timeline.get(), 0, batch.Ticket}},
+                        nullptr);
+            }
+            else {
+                _device.resetFences(batch.Fence.get());
+                Commands::Submit(_queue, batch.Commands.get(), {}, batch.Fence.get());
+            }
+            _inFlight.push_back(_current);
+            _current = (_current + 1) % _batches.size();
+            // Back pressure on the batch count, the next one may still be executing
+            while (std::find(_inFlight.begin(), _inFlight.end(), _current) != _inFlight.end()) Retire(true);
+            return batch.Ticket;
+        }
+
+        // Never blocks. True once the copies finished on the device
+        bool IsDone(uint64_t ticket) {
+            if (_timeline) return _device.getSemaphoreCounterValue(_timeline.get()) >= ticket;
+            Poll();
+            return ticket <= _completed;
+        }
+
+        // Blocks until the ticket's batch retired, flushing it first if needed
+        void Wait(uint64_t ticket) {
+            if (ticket > _submitted) Flush();
+            while (_completed < ticket && !_inFlight.empty()) Retire(true);
+        }
+
+        // Retires finished batches without waiting, which frees their part of the ring
+        void Poll() {
+            while (!_inFlight.empty() && Retire(false)) { }
+        }
+
+        // Records the acquire half of every upload the consumer has not taken yet into a command buffer of the
+        // consumer family, before anything reads them. The returned hand-off goes into that command buffer's
+        // submission; it is empty when there is nothing to wait for, always so with the fence fallback
+        Handoff Acquire(vk::CommandBuffer cmd) {
+            Poll();
+            if (_acquire.empty()) return {};
+            const QueueTransfer handover(_family, _consumer.Family);
+            for (const auto& x : _acquire) {
+                if (x.Image) {
+                    handover.AcquireImage(cmd, x.Image, x.MipLevels, vk::ImageLayout::eTransferDstOptimal, x.Layout,
+                            _consumer.Access, _consumer.Stage);
+                }
+                else {
+                    handover.AcquireBuffer(cmd, x.Buffer, _consumer.Access, _consumer.Stage);
+                }
+            }
+            _acquire.clear();
+            if (!_timeline) return {};
+            return {_timeline.get(), _consumer.Stage, nullptr, _acquireTicket, 0};
+        }
+
+        // False on the fence fallback, where Acquire only hands over batches that retired
+        bool HasTimeline() const noexcept { return static_cast<bool>(_timeline); }
+
+    private:
+        // A resource to hand to the consumer once its last chunk is copied, a buffer unless Image is set
+        struct Handover {
+            vk::Buffer Buffer;
+            vk::Image Image;
+            uint32_t MipLevels = 0;
+            vk::ImageLayout Layout = vk::ImageLayout::eUndefined;
+        };
+
+        struct Batch {
+            vk::UniqueCommandBuffer Commands;
+            vk::UniqueFence Fence; // Only without a timeline
+            bool Recording = false;
+            uint64_t Ticket = 0;
+            vk::DeviceSize RingEnd = 0, Bytes = 0;
+            std::vector<Handover> Handovers; // Until submitted, with the fallback until retired
+        };
+
+        Batch& Current() {
+            auto& batch = _batches[_current];
+            if (!batch.Recording) {
+                batch.Commands->begin(vk::CommandBufferBeginInfo(vk::CommandBufferUsageFlagBits::eOneTimeSubmit));
+                batch.Recording = true;
+                batch.Bytes = 0;
+            }
+            return batch;
+        }
+
+        // Copies into the ring and returns the offset, waiting for room if needed. Copy regions need offsets
+        // aligned to 4 bytes and to the texel size, 16 covers every format the renderer uploads
+        vk::DeviceSize Stage(const void* data, vk::DeviceSize size) {
+            const auto aligned = (size + 15) / 16 * 16;
+            if (aligned > _capacity) throw ChunkTooLarge();
+            for (;;) {
+                if (const auto offset = Reserve(aligned)) {
+                    std::memcpy(_mapped + *offset, data, size);
+                    return *offset;
+                }
+                if (_batches[_current].Recording) Flush();
+                else Retire(true);
+            }
+        }
+
+        std::optional<vk::DeviceSize> Reserve(vk::DeviceSize size) {
+            if (_used == 0) _head = _tail = 0;
+            if (_used + size > _capacity) return std::nullopt;
+            vk::DeviceSize offset, taken = size;
+            if (_head >= _tail && _head + size <= _capacity) {
+                offset = _head;
+            }
+            else if (_head >= _tail && size <= _tail) {
+                // Wraps, the end of the ring stays unused until the batches before retire
+                offset = 0;
+                taken += _capacity - _head;
+            }
+            else if (_head < _tail && _head + size <= _tail) {
+                offset = _head;
+            }
+            else {
+                return std::nullopt;
+            }
+            if (_used + taken > _capacity) return std::nullopt;
+            _head = offset + size;
+            _used += taken;
+            Current().Bytes += taken;
+            return offset;
+        }
+
+        bool IsComplete(const Batch& batch, bool wait) {
+            if (_timeline) {
+                if (!wait) return _device.getSemaphoreCounterValue(_timeline.get()) >= batch.Ticket;
+                const auto semaphore = _timeline.get();
+                (void) _device.waitSemaphores(vk::SemaphoreWaitInfo({}, 1, &semaphore, &batch.Ticket),
+                        std::numeric_limits<uint64_t>::max());
+                return true;
+            }
+            if (wait) {
+                (void) _device.waitForFences(batch.Fence.get(), true, std::numeric_limits<uint64_t>::max());
+                return true;
+            }
+            return _device.getFenceStatus(batch.Fence.get()) == vk::Result::eSuccess;
+        }
+
+        // The oldest batch, when it finished or `wait` is set
+        bool Retire(bool wait) {
+            auto& batch = _batches[_inFlight.front()];
+            if (!IsComplete(batch, wait)) return false;
+            _inFlight.pop_front();
+            _used -= batch.Bytes;
+            _tail = batch.RingEnd;
+            _completed = batch.Ticket;
+            _acquire.insert(_acquire.end(), batch.Handovers.begin(), batch.Handovers.end());
+            batch.Handovers.clear();
+            return true;
+        }
+
+        vk::DeviceSize GetMaxChunk() const noexcept { return _capacity / 4; }
+
+        // Whole mips on queues whose granularity is (0, 0, 0), otherwise multiples of the granularity's height
+        uint32_t GetRowsPerChunk(vk::Extent2D extent, vk::DeviceSize rowBytes) const {
+            if (_granularity.width == 0 || _granularity.height == 0) return extent.height;
+            const auto fit = static_cast<uint32_t>(std::max<vk::DeviceSize>(GetMaxChunk() / rowBytes, 1));
+            const auto rows = std::max(fit / _granularity.height * _granularity.height, _granularity.height);
+            return std::min(rows, extent.height);
+        }
+
+        vk::Device _device;
+        vk::Queue _queue;
+        uint32_t _family;
+        Consumer _consumer;
+        vk::Extent3D _granularity;
+        vk::DeviceSize _capacity = 0, _head = 0, _tail = 0, _used = 0;
+        char* _mapped = nullptr;
+        // The buffer goes before the memory bound to it
+        Allocation _memory;
+        vk::UniqueBuffer _staging;
+        vk::UniqueCommandPool _pool;
+        vk::UniqueSemaphore _timeline; // Counts the tickets the device finished
+        std::vector<Batch> _batches;
+        std::deque<size_t> _inFlight;
+        size_t _current = 0;
+        uint64_t _submitted = 0, _completed = 0;
+        std::vector<Handover> _acquire;
+        uint64_t _acquireTicket = 0; // The newest batch holding anything in _acquire, with a timeline
+    };
+}